@@ -39,16 +39,19 @@ public:
     buffer() {
         size = 0;
         buf = nullptr;
+        owner = true;
     }
 
     buffer(std::size_t length) {
         size = length;
         buf = new value_type[size];
+        owner = true;
     }
 
     buffer(std::size_t length, const char_type *data) {
         size = length;
         buf = new value_type[size];
+        owner = true;
         for (std::size_t i = 0; i < length; ++i) {
           buf[i] = data[i];
         }
@@ -57,6 +60,7 @@ public:
     buffer(std::initializer_list<char_type> data) {
       size = data.size();
       buf = new value_type[size];
+      owner = true;
       size_t i = 0;
       for (auto c : data) {
           buf[i] = c;
@@ -67,22 +71,39 @@ public:
     buffer(buffer&& o) {
         size = o.size;
         o.size = 0;
-        delete[] buf;
         buf = o.buf;
         o.buf =  nullptr;
+        owner = o.owner;
+    }
+
+    /**
+     * Buffer qui lit les length lettres de data sans les copier ni les libérer
+     * (par exemple un fichier projeté en mémoire, voir idx::mapped_file)
+     */
+    static buffer view(std::size_t length, const char_type *data) {
+        buffer b;
+        b.size = length;
+        b.buf = const_cast<value_type *>(data);
+        b.owner = false;
+        return b;
     }
 
     virtual ~buffer() {
 //      std::cerr << "~buffer()" << std::endl;
-      delete[] buf;
+      if (owner) {
+        delete[] buf;
+      }
     }
 
     buffer& operator=(buffer&& o) {
         size = o.size;
         o.size = 0;
-        delete[] buf;
+        if (owner) {
+          delete[] buf;
+        }
         buf = o.buf;
         o.buf =  nullptr;
+        owner = o.owner;
         return *this;
     }
 
@@ -111,6 +132,7 @@ private:
 private:
     std::size_t size;
     value_type* buf;
+    bool owner; // faux pour une vue (voir view), dont les données ne sont pas libérées
 };
 
 template<typename char_type>
@@ -21,6 +21,8 @@
 
 #include <random>
 #include <fstream>
+#include <cctype>
+#include <cstring>
 
 buffer::buffer<unsigned char> generate_degenerate_text(std::size_t text_length) {
   buffer::buffer<unsigned char> text(text_length + 1);
@@ -185,44 +187,78 @@ buffer::buffer<unsigned char> read_pattern(std::ifstream &f) {
   return buf;
 }
 
-buffer::buffer<unsigned char> read_text(std::ifstream &f) {
+std::vector<buffer::buffer<unsigned char> > read_patterns(std::ifstream &f) {
+  std::vector<buffer::buffer<unsigned char> > patterns;
+  while (f.peek() != std::ifstream::traits_type::eof()) {
+    patterns.push_back(read_pattern(f));
+  }
+  return patterns;
+}
+
+/**
+ * Lettres IUPAC rangées selon leur masque : la lettre d'indice k est l'union des lettres
+ * des bits de k + 1 (A = 1, C = 2, G = 4, T = 8)
+ */
+static const char iupac_letters[] = "ACMGRSVTWYHKDBN";
+
+/**
+ * Lit un enregistrement FASTA : son en-tête (sans le '>') dans header et ses lettres
+ * (codes IUPAC en majuscules ou en minuscules) à la fin de v. Le flux est laissé au
+ * début de l'enregistrement suivant.
+ */
+static void read_record(std::ifstream &f, std::string &header, std::vector<unsigned char> &v) {
   char c;
   if (!f.get(c) || c != '>') {
     throw std::runtime_error("invalid format");
   }
 
-  std::string line;
-  if (!getline(f, line)) {
+  if (!getline(f, header)) {
     throw std::runtime_error("invalid format");
   }
 
-  std::vector<unsigned char> v;
   while (f.get(c) && c != '>') {
-    switch (c) {
-    case 'A':
-      v.push_back(1);
-      break;
-    case 'C':
-      v.push_back(2);
-      break;
-    case 'G':
-      v.push_back(4);
-      break;
-    case 'T':
-      v.push_back(8);
-      break;
-    case '\n':
-    case '\r':
-      break;
-    default:
+    if (c == '\n' || c == '\r') {
+      continue;
+    }
+    const char *l = std::strchr(iupac_letters, std::toupper((unsigned char) c));
+    if (c == 0 || l == nullptr) {
       throw std::runtime_error("invalid format");
     }
+    v.push_back(l - iupac_letters + 1);
   }
-  v.push_back(0);
 
   if (!f.eof()) {
     f.unget();
   }
+}
+
+buffer::buffer<unsigned char> read_text(std::ifstream &f) {
+  std::string header;
+  std::vector<unsigned char> v;
+  read_record(f, header, v);
+  v.push_back(0);
+
+  buffer::buffer<unsigned char> buf(v.size(), v.data());
+  return buf;
+}
+
+buffer::buffer<unsigned char> read_sequences(std::ifstream &f, std::vector<std::string> &names) {
+  std::vector<unsigned char> v;
+  std::string header;
+  do {
+    std::size_t begin = v.size();
+    read_record(f, header, v);
+    if (v.size() == begin) {
+      continue; // enregistrement vide
+    }
+    v.push_back(0);
+    std::size_t first = header.find_first_not_of(" \t");
+    std::size_t last = header.find_first_of(" \t\r", first);
+    names.push_back(first == std::string::npos ? std::string() : header.substr(first, last - first));
+  } while (f.peek() == '>');
+  if (v.empty()) {
+    throw std::runtime_error("invalid format");
+  }
 
   buffer::buffer<unsigned char> buf(v.size(), v.data());
   return buf;
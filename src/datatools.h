@@ -22,6 +22,8 @@
 #include "buffer/buffer.h"
 
 #include <iostream>
+#include <string>
+#include <vector>
 
 buffer::buffer<unsigned char> generate_degenerate_text(std::size_t text_length);
 
@@ -35,6 +37,18 @@ void gen_text(size_t num, size_t length);
 
 buffer::buffer<unsigned char> read_pattern(std::ifstream &f);
 
+/**
+ * Lit tous les motifs du fichier
+ */
+std::vector<buffer::buffer<unsigned char> > read_patterns(std::ifstream &f);
+
 buffer::buffer<unsigned char> read_text(std::ifstream &f);
 
+/**
+ * Lit tous les enregistrements du fichier FASTA, mis bout à bout et séparés par des 0,
+ * le dernier étant suivi du 0 final (voir idx::sequence_table). Le nom de chaque séquence,
+ * premier mot de son en-tête, est ajouté à names. Les enregistrements vides sont ignorés.
+ */
+buffer::buffer<unsigned char> read_sequences(std::ifstream &f, std::vector<std::string> &names);
+
 #endif /* SRC_DATAGEN_H_ */
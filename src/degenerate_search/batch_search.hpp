@@ -0,0 +1,409 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef SRC_DEGENERATE_SEARCH_BATCH_SEARCH_HPP_
+#define SRC_DEGENERATE_SEARCH_BATCH_SEARCH_HPP_
+
+#include "buffer/buffer.h"
+#include "degenerate_search/degenerate_search.hpp"
+#include "degenerate_search/pattern_trie.hpp"
+#include "index/parallel.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Résultat de la recherche d'un motif
+ */
+struct pattern_result {
+  std::uint64_t count = 0; // nombre d'occurrences
+  std::vector<std::size_t> positions; // positions des occurrences dans le texte, triées (vide si count_only)
+  // séquences des occurrences et leur nombre d'occurrences, par séquence croissante (avec by_document)
+  std::vector<idx::document_array::document_count> documents;
+  double search_time = 0.0; // en secondes, localisation des occurrences comprise
+};
+
+/**
+ * documents : séquences des positions de positions (voir idx::sequence_table) et leur nombre
+ * d'occurrences, par séquence croissante
+ */
+template<class preproc_type>
+void count_documents(const preproc_type &pp, const std::vector<std::size_t> &positions,
+    std::vector<idx::document_array::document_count> &documents) {
+  documents.clear();
+  for (std::size_t p : positions) {
+    documents.push_back(idx::document_array::document_count(pp.sequences.sequence_at(p), 1));
+  }
+  idx::document_array::merge(documents);
+}
+
+/**
+ * File de tâches d'un thread.
+ * Le propriétaire empile et dépile ses tâches par l'avant (parcours en profondeur),
+ * les autres threads volent par l'arrière les tâches les plus anciennes, donc les plus grosses.
+ */
+template<class task_type>
+class task_queue {
+public:
+  void push(task_type &&task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    tasks.push_front(std::move(task));
+  }
+
+  bool pop(task_type &task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty()) {
+      return false;
+    }
+    task = std::move(tasks.front());
+    tasks.pop_front();
+    return true;
+  }
+
+  bool steal(task_type &task) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (tasks.empty()) {
+      return false;
+    }
+    task = std::move(tasks.back());
+    tasks.pop_back();
+    return true;
+  }
+
+private:
+  std::deque<task_type> tasks;
+  std::mutex mutex;
+};
+
+/**
+ * Recherche tous les motifs de patterns dans le même index pp, avec num_threads threads.
+ * Le résultat j correspond au motif patterns[j], quel que soit le nombre de threads.
+ *
+ * Les motifs sont rangés dans un trie de leurs suffixes (pattern_trie) : la recherche arrière
+ * parcourt ce trie et les motifs partagent les intervalles de leurs suffixes communs ; elle ne
+ * se sépare qu'aux nœuds où les motifs diffèrent. Les motifs identiques ne sont recherchés qu'une fois.
+ * Le temps de recherche d'un motif est la somme des temps des nœuds de son chemin.
+ * frontier_type : structure des ensembles d'intervalles (voir degenerate_backward_search_frontier).
+ * Avec count_only, seul le nombre d'occurrences est calculé, comme la somme des largeurs
+ * des intervalles : la table des suffixes n'est pas utilisée (pp peut ne pas en avoir).
+ * Avec by_document, les occurrences ne sont pas localisées : leurs séquences et leur nombre dans
+ * chaque séquence sont lus sur les intervalles dans le tableau des documents (pp.list_documents),
+ * pour un coût qui dépend du nombre de séquences distinctes et non du nombre d'occurrences.
+ * Demande pp.has_documents().
+ *
+ * Si pp a une table des k-mots (pp.kmers, voir idx::kmer_table), les tâches initiales sont les
+ * nœuds de profondeur k, dont les intervalles sont lus dans la table (degenerate_kmer_start),
+ * et les nœuds moins profonds où se terminent des motifs de longueur inférieure à k,
+ * recherchés sans partage. Les autres nœuds de profondeur inférieure à k ne sont pas traités.
+ *
+ * Avec frontier_cap > 0, lorsque l'ensemble d'intervalles d'un nœud v dépasse frontier_cap intervalles
+ * et que localiser ses lignes (environ sa_sample_rate / 2 étapes par ligne) coûte moins que
+ * de poursuivre la recherche arrière (un pas par intervalle et par lettre restante), les lignes sont
+ * localisées et les lettres restantes des motifs du sous-arbre de v sont vérifiées directement sur
+ * la copie du texte (pp.text, voir idx::packed_text). Le coût d'un motif très dégénéré est ainsi borné
+ * par le nombre d'occurrences de son suffixe au lieu de croître avec le nombre de ses positions dégénérées.
+ * Demande une table des suffixes et une copie du texte.
+ *
+ * L'index n'est que lu pendant la recherche : il est partagé par tous les threads.
+ * Une tâche est un nœud du trie avec l'ensemble d'intervalles de son père ; en la traitant, un thread
+ * ajoute les fils du nœud à sa file. Un thread dont la file est vide vole une tâche à l'arrière de la
+ * file d'un autre thread, ce qui équilibre la charge même lorsque le coût des motifs dégénérés est très inégal.
+ * S'il n'en trouve aucune, il attend qu'une tâche soit ajoutée ou que la dernière soit terminée.
+ */
+template<typename index_type, class frontier_type, class preproc_type, class multi_letter_type>
+std::vector<pattern_result> batch_search(const preproc_type &pp,
+    const std::vector<buffer::buffer<unsigned char> > &patterns, const std::vector<multi_letter_type> &letters,
+    unsigned int num_threads = 1, bool count_only = false, std::size_t frontier_cap = 0, bool by_document = false) {
+  typedef frontier_type frontier;
+  struct task {
+    std::size_t node;
+    // nul pour les tâches initiales
+    std::shared_ptr<const frontier> parent_frontier;
+  };
+
+  if (frontier_cap > 0 && !(pp.has_suffix_array() && pp.has_text())) {
+    throw std::runtime_error("the frontier cap needs the suffix array and a copy of the text");
+  }
+  if (by_document && !pp.has_documents()) {
+    throw std::runtime_error("the index has no document array, rebuild it with --documents");
+  }
+
+  pattern_trie<unsigned char> trie(patterns);
+  compatible_letter_table compatible(letters, pp.C.data(), letters);
+  const std::size_t kmer_length = pp.kmers.get_k();
+  std::vector<pattern_result> results(patterns.size());
+  std::vector<double> node_time(trie.get_num_nodes(), 0.0);
+
+  // accepts[a] : masque des lettres du texte compatibles avec la lettre a des motifs
+  std::vector<std::uint64_t> accepts(letters.size(), 0);
+  std::size_t num_text_letters = 0;
+  if (frontier_cap > 0) {
+    for (std::size_t a = 0; a < letters.size(); ++a) {
+      for (int c : compatible[a]) {
+        accepts[a] |= (std::uint64_t) 1 << c;
+      }
+    }
+    for (std::size_t c = 1; c < letters.size(); ++c) {
+      if (pp.C[c] < pp.C[c + 1]) {
+        ++num_text_letters;
+      }
+    }
+  }
+
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  std::vector<task_queue<task> > queues(num_threads);
+  std::atomic<std::size_t> pending(0); // tâches créées et pas encore terminées
+  std::atomic<std::size_t> queued(0); // tâches dans les files
+  std::mutex idle_mutex;
+  std::condition_variable idle;
+
+  // réveille les threads sans tâche après l'ajout de tâches ou la fin de la dernière
+  auto wake_idle = [&]() {
+    {
+      std::lock_guard<std::mutex> lock(idle_mutex);
+    }
+    idle.notify_all();
+  };
+
+  auto push_children = [&](unsigned int t, std::size_t v, const std::shared_ptr<const frontier> &I) {
+    for (auto child : trie[v].children) {
+      ++pending;
+      queues[t].push(task { child.second, I });
+      ++queued;
+    }
+    if (!trie[v].children.empty()) {
+      wake_idle();
+    }
+  };
+
+  // le résultat du premier motif du nœud v est aussi celui des motifs identiques
+  auto share_result = [&](std::size_t v) {
+    const auto &patterns_v = trie[v].patterns;
+    for (std::size_t k = 1; k < patterns_v.size(); ++k) {
+      results[patterns_v[k]].count = results[patterns_v[0]].count;
+      results[patterns_v[k]].positions = results[patterns_v[0]].positions;
+      results[patterns_v[k]].documents = results[patterns_v[0]].documents;
+    }
+  };
+
+  // Compare le coût de la localisation des lignes de I (sa_sample_rate / 2 étapes par ligne)
+  // au nombre d'intervalles que la recherche arrière calculerait encore sous v : au nœud w, au plus
+  // le nombre d'intervalles de I fois le nombre de mots compatibles avec les lettres de v à w,
+  // et au plus le nombre de lignes de I fois la proportion de ces mots dans un texte aléatoire.
+  auto cheaper_to_verify = [&](std::size_t v, const frontier &I) {
+    double num_intervals = 0;
+    double width = 0;
+    for (auto r : I) {
+      ++num_intervals;
+      width += (double) (r.get_high() - r.get_low()) + 1;
+    }
+    if (num_intervals <= frontier_cap) {
+      return false;
+    }
+    const double locate_cost = width * pp.sa_sample_rate / 2;
+    double search_cost = 0;
+    struct estimate {
+      std::size_t node;
+      double words; // nombre de mots compatibles avec les lettres de v au nœud
+      double ratio; // proportion de ces mots parmi les mots de même longueur
+    };
+    std::vector<estimate> stack(1, estimate { v, 1.0, 1.0 });
+    while (!stack.empty() && search_cost <= locate_cost) {
+      estimate e = stack.back();
+      stack.pop_back();
+      for (auto child : trie[e.node].children) {
+        std::size_t choices = compatible[child.first].size();
+        estimate next { child.second, e.words * choices, e.ratio * choices / num_text_letters };
+        search_cost += std::min(num_intervals * next.words, width * next.ratio);
+        stack.push_back(next);
+      }
+    }
+    return search_cost > locate_cost;
+  };
+
+  // localise les lignes de I, début des occurrences du chemin de v, et vérifie les lettres
+  // suivantes des motifs du sous-arbre de v en les lisant dans le texte, en partageant
+  // les vérifications des lettres communes comme la recherche arrière
+  auto verify_subtree = [&](std::size_t v, const frontier &I) {
+    struct candidates {
+      std::size_t node;
+      std::vector<std::size_t> starts; // débuts des occurrences du chemin de node
+    };
+    std::vector<candidates> stack(1);
+    stack[0].node = v;
+    for (auto r : I) {
+      pp.locate_range(r.get_low(), r.get_high(), stack[0].starts);
+    }
+    while (!stack.empty()) {
+      candidates c = std::move(stack.back());
+      stack.pop_back();
+      const auto &w = trie[c.node];
+      if (c.node != v && !w.patterns.empty()) {
+        pattern_result &result = results[w.patterns[0]];
+        result.count = c.starts.size();
+        if (by_document) {
+          count_documents(pp, c.starts, result.documents);
+        } else if (!count_only) {
+          result.positions = c.starts;
+          std::sort(result.positions.begin(), result.positions.end());
+        }
+        share_result(c.node);
+      }
+      for (auto child : w.children) {
+        std::uint64_t mask = accepts[child.first];
+        candidates next;
+        next.node = child.second;
+        for (std::size_t q : c.starts) {
+          // le texte copié ne garde pas les séparateurs : pas d'extension avant un début de séquence
+          if (q > 0 && !pp.sequences.is_start(q) && ((mask >> pp.text[q - 1]) & 1)) {
+            next.starts.push_back(q - 1);
+          }
+        }
+        if (!next.starts.empty()) {
+          stack.push_back(std::move(next));
+        }
+      }
+    }
+  };
+
+  auto process = [&](unsigned int t, const task &tk, backward_step_buffers<index_type> &buffers) {
+    std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+
+    const auto &v = trie[tk.node];
+    std::shared_ptr<frontier> I = std::make_shared<frontier>();
+    if (v.depth <= kmer_length) {
+      // lettres du chemin de v à la racine, de gauche à droite dans le motif
+      std::vector<const std::vector<int> *> path;
+      for (std::size_t w = tk.node; w != pattern_trie<unsigned char>::root; w = trie[w].parent) {
+        path.push_back(&compatible[trie[w].letter]);
+      }
+      if (v.depth == kmer_length) {
+        degenerate_kmer_start(path, pp.kmers, *I);
+      } else {
+        // motif plus court que k : recherche arrière complète de son chemin
+        frontier I2;
+        degenerate_backward_start(*path.back(), pp.C.data(), *I);
+        for (std::size_t d = path.size() - 1; d > 0 && !I->empty(); --d) {
+          degenerate_backward_step(*I, *path[d - 1], pp.occ, pp.C.data(), buffers, I2);
+          std::swap(*I, I2);
+        }
+      }
+    } else if (tk.parent_frontier) {
+      degenerate_backward_step(*tk.parent_frontier, compatible[v.letter], pp.occ, pp.C.data(), buffers, *I);
+    } else {
+      degenerate_backward_start(compatible[v.letter], pp.C.data(), *I);
+    }
+
+    if (!v.patterns.empty()) {
+      pattern_result &result = results[v.patterns[0]];
+      for (auto r : *I) {
+        result.count += (std::uint64_t) (r.get_high() - r.get_low()) + 1;
+      }
+      if (by_document) {
+        for (auto r : *I) {
+          pp.list_documents(r.get_low(), r.get_high(), result.documents);
+        }
+        idx::document_array::merge(result.documents);
+      } else if (!count_only) {
+        for (auto r : *I) {
+          for (index_type p = r.get_low(); p <= r.get_high(); ++p) {
+            result.positions.push_back(pp.locate(p));
+          }
+        }
+        std::sort(result.positions.begin(), result.positions.end());
+      }
+      share_result(tk.node);
+    }
+    if (!I->empty() && v.depth >= kmer_length) {
+      if (frontier_cap > 0 && cheaper_to_verify(tk.node, *I)) {
+        verify_subtree(tk.node, *I);
+      } else {
+        push_children(t, tk.node, I);
+      }
+    }
+
+    std::chrono::duration<double> time_span = std::chrono::high_resolution_clock::now() - t1;
+    node_time[tk.node] = time_span.count();
+  };
+
+  auto worker = [&](unsigned int t) {
+    backward_step_buffers<index_type> buffers(letters.size());
+    task tk;
+    for (;;) {
+      bool found = queues[t].pop(tk);
+      for (unsigned int k = 1; !found && k < num_threads; ++k) {
+        found = queues[(t + k) % num_threads].steal(tk);
+      }
+      if (!found) {
+        // d'autres threads traitent encore des tâches et peuvent en créer : attente d'une tâche
+        // ou de la fin de la dernière
+        std::unique_lock<std::mutex> lock(idle_mutex);
+        idle.wait(lock, [&]() { return pending == 0 || queued > 0; });
+        if (pending == 0) {
+          return;
+        }
+        continue;
+      }
+      --queued;
+      process(t, tk, buffers);
+      tk.parent_frontier.reset();
+      if (--pending == 0) {
+        wake_idle();
+      }
+    }
+  };
+
+  // les tâches initiales (les fils de la racine s'il n'y a pas de table des k-mots)
+  // sont réparties entre les threads
+  unsigned int t = 0;
+  for (std::size_t v = 0; v < trie.get_num_nodes(); ++v) {
+    const auto &node = trie[v];
+    if (node.depth == std::max<std::size_t>(kmer_length, 1) || (node.depth > 0 && node.depth < kmer_length
+        && !node.patterns.empty())) {
+      ++pending;
+      ++queued;
+      queues[t].push(task { v, std::shared_ptr<const frontier>() });
+      t = (t + 1) % num_threads;
+    }
+  }
+
+  idx::parallel_threads(num_threads, worker);
+
+  for (std::size_t v = 0; v < trie.get_num_nodes(); ++v) {
+    for (std::size_t j : trie[v].patterns) {
+      double time = 0.0;
+      for (std::size_t w = v; w != pattern_trie<unsigned char>::root; w = trie[w].parent) {
+        time += node_time[w];
+      }
+      results[j].search_time = time;
+    }
+  }
+  return results;
+}
+
+#endif /* SRC_DEGENERATE_SEARCH_BATCH_SEARCH_HPP_ */
@@ -0,0 +1,234 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef SRC_DEGENERATE_SEARCH_BIDIRECTIONAL_SEARCH_HPP_
+#define SRC_DEGENERATE_SEARCH_BIDIRECTIONAL_SEARCH_HPP_
+
+#include "buffer/buffer.h"
+#include "degenerate_search/degenerate_search.hpp"
+#include "degenerate_search/batch_search.hpp"
+#include "index/parallel.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Intervalle synchronisé d'un mot w : [low, high] est l'intervalle de w dans la BWT du texte,
+ * [rev_low, rev_low + high - low] celui du retourné de w dans la BWT du texte retourné
+ * (preproc_backward_search2::occ_rev). Les deux intervalles ont la même largeur,
+ * le nombre d'occurrences de w.
+ */
+template<typename index_type>
+struct bidirectional_range {
+  index_type low;
+  index_type high;
+  index_type rev_low;
+};
+
+/**
+ * Tableaux de travail d'une recherche bidirectionnelle, réutilisés d'un motif à l'autre
+ */
+template<typename index_type>
+struct bidirectional_buffers {
+  bidirectional_buffers(std::size_t alpha_size) : low_counts(alpha_size), high_counts(alpha_size) {
+  }
+
+  std::vector<std::size_t> low_counts;
+  std::vector<std::size_t> high_counts;
+  std::vector<bidirectional_range<index_type> > next;
+};
+
+/**
+ * Étend chaque intervalle synchronisé de I d'une lettre de letters (triées, voir compatible_letter_table),
+ * à gauche si left est vrai, à droite sinon, et range le résultat dans I2.
+ *
+ * occ est la structure de rang de la BWT dans laquelle on étend : celle du texte pour
+ * une extension à gauche, celle du texte retourné pour une extension à droite.
+ * Dans l'autre BWT, les occurrences de cw (resp. wc) sont triées selon la lettre c :
+ * le nouvel intervalle commence après celles des lettres plus petites que c, que l'on
+ * compte avec occ.rank_all (le 0 final compris, qui est la plus petite lettre).
+ */
+template<typename index_type, class occ_type>
+void bidirectional_step(const std::vector<bidirectional_range<index_type> > &I, const std::vector<int> &letters,
+    const occ_type &occ, const size_t *C, bool left, bidirectional_buffers<index_type> &buffers,
+    std::vector<bidirectional_range<index_type> > &I2) {
+  std::size_t *low_counts = buffers.low_counts.data();
+  std::size_t *high_counts = buffers.high_counts.data();
+  I2.clear();
+  for (const bidirectional_range<index_type> &r : I) {
+    index_type width = r.high - r.low;
+    // a : début de l'intervalle dans la BWT où l'on étend, b : début dans l'autre BWT
+    index_type a = left ? r.low : r.rev_low;
+    index_type b = left ? r.rev_low : r.low;
+    occ.rank_all(a, low_counts);
+    occ.rank_all(a + width + 1, high_counts);
+
+    std::size_t smaller = 0;
+    int c = 0;
+    for (int l : letters) {
+      for (; c < l; ++c) {
+        smaller += high_counts[c] - low_counts[c];
+      }
+      if (high_counts[l] > low_counts[l]) {
+        index_type new_a = C[l] + low_counts[l];
+        index_type new_width = high_counts[l] - low_counts[l] - 1;
+        index_type new_b = b + smaller;
+        if (left) {
+          I2.push_back(bidirectional_range<index_type> { new_a, new_a + new_width, new_b });
+        } else {
+          I2.push_back(bidirectional_range<index_type> { new_b, new_b + new_width, new_a });
+        }
+      }
+    }
+  }
+}
+
+/**
+ * Position de départ de la recherche bidirectionnelle de x : une position du plus long bloc
+ * de lettres solides (une seule lettre compatible) ou, s'il n'y en a pas, la position
+ * ayant le moins de lettres compatibles.
+ */
+inline std::size_t bidirectional_search_start(const buffer::buffer<unsigned char> &x,
+    const compatible_letter_table &compatible) {
+  std::size_t start = 0;
+  std::size_t best_run = 0;
+  std::size_t run = 0;
+  for (std::size_t i = 0; i < x.length(); ++i) {
+    run = compatible[x[i]].size() == 1 ? run + 1 : 0;
+    if (run > best_run) {
+      best_run = run;
+      start = i;
+    }
+  }
+  if (best_run == 0) {
+    for (std::size_t i = 1; i < x.length(); ++i) {
+      if (compatible[x[i]].size() < compatible[x[start]].size()) {
+        start = i;
+      }
+    }
+  }
+  return start;
+}
+
+/**
+ * Recherche bidirectionnelle du motif dégénéré x dans l'index pp, qui doit avoir une BWT
+ * du texte retourné (preproc_backward_search2::has_reverse_occ).
+ * La recherche part de bidirectional_search_start(x) puis étend le mot reconnu du côté
+ * dont la lettre suivante a le moins de lettres compatibles (à gauche en cas d'égalité) :
+ * les blocs solides sont ainsi reconnus avant les positions dégénérées, qui ne multiplient
+ * que des intervalles déjà peu nombreux.
+ * Au retour, les intervalles [low, high] de I, disjoints, sont les lignes de la BWT du texte
+ * des occurrences de x (dans un ordre quelconque).
+ */
+template<typename index_type, class preproc_type>
+void bidirectional_search(const preproc_type &pp, const buffer::buffer<unsigned char> &x,
+    const compatible_letter_table &compatible, bidirectional_buffers<index_type> &buffers,
+    std::vector<bidirectional_range<index_type> > &I) {
+  assert(x.length() > 0);
+  I.clear();
+
+  std::size_t left = bidirectional_search_start(x, compatible);
+  std::size_t right = left + 1; // le mot reconnu est x[left .. right - 1]
+  for (int c : compatible[x[left]]) {
+    index_type low = pp.C[c];
+    index_type high = pp.C[c + 1] - 1;
+    I.push_back(bidirectional_range<index_type> { low, high, low });
+  }
+
+  while (!I.empty() && (left > 0 || right < x.length())) {
+    bool to_left = right == x.length()
+        || (left > 0 && compatible[x[left - 1]].size() <= compatible[x[right]].size());
+    if (to_left) {
+      --left;
+      bidirectional_step(I, compatible[x[left]], pp.occ, pp.C.data(), true, buffers, buffers.next);
+    } else {
+      bidirectional_step(I, compatible[x[right]], pp.occ_rev, pp.C.data(), false, buffers, buffers.next);
+      ++right;
+    }
+    std::swap(I, buffers.next);
+  }
+}
+
+/**
+ * Recherche chaque motif de patterns avec bidirectional_search, avec num_threads threads
+ * qui se partagent les motifs. Le résultat j correspond au motif patterns[j].
+ * Contrairement à batch_search, les motifs ne partagent pas leurs suffixes communs :
+ * chacun part de son propre bloc le plus sélectif.
+ * Avec count_only, seul le nombre d'occurrences est calculé (pp peut ne pas avoir de table des suffixes).
+ * Avec by_document, les séquences des occurrences sont lues dans le tableau des documents
+ * (voir batch_search).
+ */
+template<typename index_type, class preproc_type, class multi_letter_type>
+std::vector<pattern_result> bidirectional_batch_search(const preproc_type &pp,
+    const std::vector<buffer::buffer<unsigned char> > &patterns, const std::vector<multi_letter_type> &letters,
+    unsigned int num_threads = 1, bool count_only = false, bool by_document = false) {
+  if (!pp.has_reverse_occ()) {
+    throw std::runtime_error("the index has no reverse BWT, rebuild it with --bidirectional");
+  }
+  if (by_document && !pp.has_documents()) {
+    throw std::runtime_error("the index has no document array, rebuild it with --documents");
+  }
+
+  compatible_letter_table compatible(letters, pp.C.data(), letters);
+  std::vector<pattern_result> results(patterns.size());
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  // tampons et intervalles de chaque thread
+  std::vector<bidirectional_buffers<index_type> > all_buffers(num_threads,
+      bidirectional_buffers<index_type>(letters.size()));
+  std::vector<std::vector<bidirectional_range<index_type> > > all_intervals(num_threads);
+
+  idx::parallel_thread_tasks(patterns.size(), num_threads, [&](unsigned int t, std::size_t j) {
+    bidirectional_buffers<index_type> &buffers = all_buffers[t];
+    std::vector<bidirectional_range<index_type> > &I = all_intervals[t];
+    std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+
+    pattern_result &result = results[j];
+    if (patterns[j].length() > 0) {
+      bidirectional_search(pp, patterns[j], compatible, buffers, I);
+    } else {
+      I.clear();
+    }
+    for (const auto &r : I) {
+      result.count += (std::uint64_t) (r.high - r.low) + 1;
+    }
+    if (by_document) {
+      for (const auto &r : I) {
+        pp.list_documents(r.low, r.high, result.documents);
+      }
+      idx::document_array::merge(result.documents);
+    } else if (!count_only) {
+      for (const auto &r : I) {
+        for (index_type p = r.low; p <= r.high; ++p) {
+          result.positions.push_back(pp.locate(p));
+        }
+      }
+      std::sort(result.positions.begin(), result.positions.end());
+    }
+
+    std::chrono::duration<double> time_span = std::chrono::high_resolution_clock::now() - t1;
+    result.search_time = time_span.count();
+  });
+  return results;
+}
+
+#endif /* SRC_DEGENERATE_SEARCH_BIDIRECTIONAL_SEARCH_HPP_ */
@@ -18,259 +18,434 @@
 
 #include "sais/sais.hxx"
 #include "trees/range_tree.h"
-
+#include "trees/range_vector.h"
+#include "trees/adaptive_frontier.h"
+#include "index/compact_rank.h"
+#include "index/dna_occ.h"
+#include "index/index_format.h"
+#include "index/kmer_table.h"
+#include "index/mapped_file.h"
+#include "index/packed_array.h"
+#include "index/packed_text.h"
+#include "index/parallel.h"
+#include "index/parallel_suffix_sort.h"
+#include "index/external_bwt.h"
+#include "index/sequence_table.h"
+#include "index/document_array.h"
+
+#include <algorithm>
 #include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <limits>
+#ifdef __BMI2__
+#include <immintrin.h>
+#endif
 #include <list>
+#include <memory>
 #include <sdsl/vectors.hpp>
 
 #ifndef SRC_DEGENERATE_SEARCH_DEGENERATE_SEARCH_HPP_
 #define SRC_DEGENERATE_SEARCH_DEGENERATE_SEARCH_HPP_
 
-template<typename letter_index_type, class multi_letter_type>
-ranges::range_tree degenerate_backward_search_in_bwt(
-    const buffer::buffer<letter_index_type> &x, const std::vector<multi_letter_type > &alpha_x,
-    const buffer::buffer<letter_index_type> &bwt, const std::vector<multi_letter_type > &alpha_bwt);
-
 template<typename letter_type>
 void get_bucket_start(const buffer::buffer<letter_type> &bwt, size_t *C, size_t alpha_size);
 
-template<typename letter_type>
-size_t rank(int c, const buffer::buffer<letter_type> &bwt, size_t i);
+/**
+ * Table des lettres de la BWT compatibles avec chaque multi-lettre du motif.
+ * table[a] est la liste croissante des indices c de alpha_bwt tels que alpha_bwt[c]
+ * est compatible avec alpha_x[a] et apparaît dans le texte (C[c] < C[c + 1]).
+ * Calculée une fois avant la recherche, elle évite de parcourir tout alpha_bwt
+ * à chaque intervalle et à chaque étape : pour un texte solide sur ACGT, une
+ * multi-lettre n'a jamais plus de 4 lettres compatibles sur les 16 de alpha_bwt.
+ */
+class compatible_letter_table {
+public:
+  template<class multi_letter_type>
+  compatible_letter_table(const std::vector<multi_letter_type > &alpha_x, const size_t *C,
+      const std::vector<multi_letter_type > &alpha_bwt) : table(alpha_x.size()) {
+    for (std::size_t a = 0; a < alpha_x.size(); ++a) {
+      for (int c = 0; c < (int) alpha_bwt.size(); ++c) {
+        if (C[c] < C[c + 1] && alpha_bwt[c].contains_some_letters(alpha_x[a])) {
+          table[a].push_back(c);
+        }
+      }
+    }
+  }
+
+  const std::vector<int> &operator[](std::size_t a) const {
+    return table[a];
+  }
+
+private:
+  std::vector<std::vector<int> > table;
+};
+
+/**
+ * Vrai si les bornes des intervalles de lignes d'une BWT de longueur n
+ * (y compris n, utilisé pour rank) sont représentables par index_type
+ */
+template<typename index_type>
+bool fits_index_type(std::size_t n) {
+  return n <= (std::size_t) std::numeric_limits<index_type>::max();
+}
 
 template<typename letter_type>
 void get_freq(const buffer::buffer<letter_type> &bwt, size_t *C);
 
 /**
- * La seule occurence de 0 doit être à la dernière position dans text
+ * Retourne C tel que C[i] est l'indice de début du bucket de la lettre i, 0 <= i < alpha_size)
+ * C[alpha_size] vaut bwt.length()
  */
-template<typename letter_index_type, class multi_letter_type>
-std::vector<std::size_t> degenerate_backward_search(
-    const buffer::buffer<letter_index_type> &text, const std::vector<multi_letter_type > &alpha_text,
-    const buffer::buffer<letter_index_type> &pattern, const std::vector<multi_letter_type > &alpha_pattern) {
-
-  buffer::buffer<unsigned char> bwt(text.length());
-  int *SA = new int[text.length()];
+template<typename letter_type>
+void get_bucket_start(const buffer::buffer<letter_type> &bwt, size_t *C, size_t alpha_size) {
+  get_freq(bwt, C);
 
-  saisxx(text.data(), SA + 1, (int) text.length() - 1);
-  SA[0] = text.length() - 1;
-  for (size_t i = 0; i < text.length(); ++i) {
-    bwt[i] = SA[i] == 0 ? 0 : text[SA[i] - 1];
+  size_t freq = 0; // sum_{k = 0 .. i - 1}C[k]
+  for (size_t i = 0; i <= alpha_size; ++i) {
+    size_t t = C[i];
+    C[i] = freq;
+    freq += t;
   }
+}
 
-  std::chrono::high_resolution_clock::time_point t1, t2;
-  std::chrono::duration<double> time_span;
-  t1 = std::chrono::high_resolution_clock::now();
-  ranges::range_tree result = degenerate_backward_search_in_bwt(pattern, alpha_pattern, bwt, alpha_text);
-  t2 = std::chrono::high_resolution_clock::now();
-  time_span = t2 - t1;
-  std::cout << "Backward search: " << time_span.count() << std::endl;
-
-  std::vector<std::size_t> v = std::vector<std::size_t>();
-  for (auto r : result) {
-    for (int p = r.get_low(); p <= r.get_high(); ++p) {
-      v.push_back(SA[p]);
-    }
+/**
+ * Retourne C tel que C[i] = |bwt|_i (nombre de i dans bwt, , 0 <= i < alpha_size)
+ * C[alpha_size] est indéfini
+ * En entrée C doit être initialisé à 0
+ */
+template<typename letter_type>
+void get_freq(const buffer::buffer<letter_type> &bwt, size_t *C) {
+  for (size_t i = 0; i < bwt.length(); ++i) {
+    ++C[ (size_t) bwt[i] ];
   }
+}
 
-  delete[] SA;
-  return v;
+/**
+ * Ajout d'un intervalle à une frontière de la recherche arrière
+ * (ranges::basic_range_tree, std::list ou ranges::basic_range_vector)
+ */
+template<typename index_type>
+inline void add_range(ranges::basic_range_tree<index_type> &I, const ranges::basic_range<index_type> &r) {
+  I.insert(r);
 }
 
+template<typename index_type>
+inline void add_range(std::list<ranges::basic_range<index_type> > &I, const ranges::basic_range<index_type> &r) {
+  I.push_back(r);
+}
 
-template<typename letter_index_type, class multi_letter_type>
-ranges::range_tree degenerate_backward_search_in_bwt(
-    const buffer::buffer<letter_index_type> &x, const std::vector<multi_letter_type > &alpha_x,
-    const buffer::buffer<letter_index_type> &bwt, const std::vector<multi_letter_type > &alpha_bwt) {
-  size_t m = x.length();
-  ranges::range_tree I;
+template<typename index_type>
+inline void add_range(ranges::basic_range_vector<index_type> &I, const ranges::basic_range<index_type> &r) {
+  I.push_back(r);
+}
 
-  size_t *C = new size_t[alpha_bwt.size() + 1](); // +1 pour pouvoir écrire range(C[c], C[c + 1] - 1) même quand c est la dernière lettre
+template<typename index_type>
+inline void add_range(ranges::basic_adaptive_frontier<index_type> &I, const ranges::basic_range<index_type> &r) {
+  I.push_back(r);
+}
 
-  get_bucket_start(bwt, C, alpha_bwt.size());
-  /*
-  std::cerr << "C : " << std::endl;
-  for (size_t i = 0; i < alpha_bwt.size(); ++i) {
-    std::cerr << "C[" << i << "] = " << C[i] << " ";
+/**
+ * Nombre d'intervalles dont les blocs de rang sont préchargés ensemble
+ * par l'étape de la recherche arrière sur un ranges::basic_range_vector
+ */
+const std::size_t rank_batch_size = 32;
+
+/**
+ * Tampons d'une étape de la recherche arrière, réutilisés d'une étape à l'autre
+ */
+template<typename index_type>
+struct backward_step_buffers {
+  explicit backward_step_buffers(std::size_t alpha_size)
+      : low_ranks(alpha_size), high_ranks(alpha_size), runs(alpha_size),
+        positions(2 * rank_batch_size), ranks(2 * rank_batch_size) {
   }
-  std::cout << std::endl;
-   */
 
-  assert(m > 0);
+  std::vector<size_t> low_ranks;
+  std::vector<size_t> high_ranks;
+  std::vector<ranges::basic_range_vector<index_type> > runs; // intervalles obtenus pour chaque lettre
+  std::vector<size_t> positions; // bornes des intervalles d'un paquet : low, high + 1, low, high + 1...
+  std::vector<size_t> ranks; // rangs d'une lettre aux positions de positions
+  std::vector<std::uint64_t> bitmap; // lignes d'un ensemble d'intervalles qui passe en vecteur de bits
+};
 
-  //std::cerr << "Initialisation..." << std::endl;
-  //std::cerr << "x[m - 1] = " << alpha_x[ x[m - 1] ] << std::endl;
-  for (int i = 0; i < (int) alpha_bwt.size(); ++i) {
-    //std::cerr << "c = " << alpha_bwt[i] << std::endl;
-    if (alpha_bwt[i].contains_some_letters(alpha_x[ x[m - 1] ])) {
-      size_t r1 = C[i];
-      size_t r2 = C[i + 1];
-      if (r1 < r2) {
-        //std::cerr << "Insert " << ranges::range(r1, r2 - 1) << std::endl;
-        I.insert(ranges::range(r1, r2 - 1));
-      }
-    }
+/**
+ * Première étape de la recherche arrière : I reçoit les buckets des lettres de la BWT
+ * compatibles avec la dernière lettre du motif (letters, voir compatible_letter_table)
+ */
+template<class frontier_type>
+void degenerate_backward_start(const std::vector<int> &letters, const size_t *C, frontier_type &I) {
+  typedef typename frontier_type::value_type range;
+
+  I.clear();
+  for (int i : letters) {
+    //std::cerr << "Insert " << range(C[i], C[i + 1] - 1) << std::endl;
+    add_range(I, range(C[i], C[i + 1] - 1));
   }
+}
 
-  size_t k = m - 1;
-  // size_t n'est pas signé, on ne peut donc écrire while (k >= 0) ...
-  // on met donc une boucle do while au lieu d'un while
-  if (I.empty() || k == 0) {
-    delete[] C;
-    return std::move(I);
+/**
+ * Début de la recherche arrière avec une table des k-mots (voir idx::kmer_table) : I reçoit
+ * les intervalles des k-mots compatibles avec les k dernières lettres du motif, ce qui
+ * remplace degenerate_backward_start et les k - 1 étapes suivantes.
+ * letters[i] est la liste des lettres de la BWT compatibles avec la i-ème de ces k lettres,
+ * de gauche à droite (voir compatible_letter_table).
+ * Les mots sont énumérés dans l'ordre croissant de leurs codes, donc de leurs intervalles.
+ */
+template<class frontier_type>
+void degenerate_kmer_start(const std::vector<const std::vector<int> *> &letters, const idx::kmer_table &kmers,
+    frontier_type &I) {
+  typedef typename frontier_type::value_type range;
+  std::size_t k = letters.size();
+  assert(k == kmers.get_k());
+
+  I.clear();
+  for (const std::vector<int> *l : letters) {
+    if (l->empty()) {
+      return;
+    }
   }
 
-  ranges::range_tree I2;
+  std::vector<std::size_t> digits(k, 0); // digits[i] : indice de la lettre courante dans *letters[i]
+  std::size_t i;
   do {
-    --k;
-    I2 = ranges::range_tree();
-
-    //std::cerr << "Boucle k = " << k << "..." << std::endl;
-    for (auto r : I) {
-      //std::cerr << "r : " << r << std::endl;
-      for (int i = 0; i < (int) alpha_bwt.size(); ++i) {
-        auto c = alpha_bwt[i];
-        if (c.contains_some_letters(alpha_x[ x[k] ])) {
-          size_t r1 = rank(i, bwt, r.get_low());
-          size_t r2 = rank(i, bwt, r.get_high() + 1);
-//          std::cerr << "c : " << c << std::endl;
-//          std::cerr << "C[" << c << "] = " << C[i] << std::endl;
-//          std::cerr << "rank('" << c << "', bwt, " << r.get_low() << ") : " << r1 << std::endl;
-//          std::cerr << "rank('" << c << "', bwt, " << r.get_high() + 1 << ") : " << r2 << std::endl;
-          if (r1 < r2) {
-            //std::cerr << "Insert [" << C[c] + r1 << ", " << C[c] + r2 - 1<< "]" << std::endl;
-            I2.insert(ranges::range(C[i] + r1, C[i] + r2 - 1));
-          }
-        }
-      }
+    std::uint64_t code = 0;
+    for (i = 0; i < k; ++i) {
+      code = (code << 2) | idx::kmer_table::letter_code((*letters[i])[digits[i]]);
+    }
+    std::size_t count = kmers.get_count(code);
+    if (count > 0) {
+      std::size_t low = kmers.get_low(code);
+      add_range(I, range(low, low + count - 1));
     }
 
-    I = std::move(I2);
-    //std::cerr << "I : " << std::endl;
-    //for (auto r : I) {
-    //  std::cerr << "[" << r.get_low() << ", " << r.get_high() << "]" << std::endl;
-    //}
+    // mot suivant : on incrémente le compteur digits en partant de la droite
+    i = k;
+    while (i > 0 && ++digits[i - 1] == letters[i - 1]->size()) {
+      digits[i - 1] = 0;
+      --i;
+    }
+  } while (i > 0);
+}
 
-  } while (!I.empty() && k > 0);
+/**
+ * Une étape de la recherche arrière : I2 reçoit les intervalles de I étendus à gauche
+ * par une lettre du motif, letters étant la liste des lettres de la BWT qui lui sont
+ * compatibles (voir compatible_letter_table)
+ */
+template<class frontier_type, class occ_type>
+void degenerate_backward_step(const frontier_type &I,
+    const std::vector<int> &letters, const occ_type &occ, const size_t *C,
+    backward_step_buffers<typename frontier_type::value_type::value_type> &buffers, frontier_type &I2) {
+  typedef typename frontier_type::value_type range;
+
+  I2.clear();
+  // Si plusieurs lettres de la BWT sont compatibles, on calcule
+  // leurs rangs en une seule requête par borne (voir idx::dna_occ)
+  bool several = letters.size() > 1;
+  for (auto r : I) {
+    //std::cerr << "r : " << r << std::endl;
+    if (several) {
+      occ.rank_all(r.get_low(), buffers.low_ranks.data());
+      occ.rank_all(r.get_high() + 1, buffers.high_ranks.data());
+    }
+    for (int i : letters) {
+      size_t r1 = several ? buffers.low_ranks[i] : occ.rank(i, r.get_low());
+      size_t r2 = several ? buffers.high_ranks[i] : occ.rank(i, r.get_high() + 1);
 
-  delete[] C;
-  return std::move(I);
+//      std::cerr << "C[" << i << "] = " << C[i] << std::endl;
+//      std::cerr << "rank(" << i << ", bwt, " << r.get_low() << ") : " << r1 << std::endl;
+//      std::cerr << "rank(" << i << ", bwt, " << r.get_high() + 1 << ") : " << r2 << std::endl;
+      if (r1 < r2) {
+        //std::cerr << "Insert [" << C[i] + r1 << ", " << C[i] + r2 - 1<< "]" << std::endl;
+        add_range(I2, range(C[i] + r1, C[i] + r2 - 1));
+      }
+    }
+  }
 }
 
 /**
- * Retourne C tel que C[i] est l'indice de début du bucket de la lettre i, 0 <= i < alpha_size)
- * C[alpha_size] vaut bwt.length()
+ * Étape de la recherche arrière sur des intervalles triés dans un tableau.
+ * Pour une lettre c, les intervalles obtenus à partir des intervalles triés de I sont
+ * triés et se trouvent tous dans le bucket de c : la fusion des suites obtenues pour chaque
+ * lettre se réduit donc à leur concaténation dans l'ordre des lettres, les intervalles
+ * adjacents étant fusionnés au passage.
+ *
+ * Les intervalles de I sont traités par paquets de rank_batch_size : on demande d'abord
+ * le chargement en cache des blocs de rang de toutes les bornes du paquet (occ.prefetch),
+ * puis chaque lettre parcourt le paquet dans l'ordre de la BWT. Les accès mémoire d'un
+ * paquet se recouvrent au lieu d'attendre chacun le précédent.
+ * Les rangs d'une lettre sur tout le paquet sont calculés par un seul appel à occ.rank_batch
+ * (noyau vectoriel choisi à l'exécution pour idx::dna_occ, voir idx::rank_kernel).
  */
-template<typename letter_type>
-void get_bucket_start(const buffer::buffer<letter_type> &bwt, size_t *C, size_t alpha_size) {
-  get_freq(bwt, C);
+template<typename index_type, class occ_type>
+void degenerate_backward_step(const ranges::basic_range_vector<index_type> &I,
+    const std::vector<int> &letters, const occ_type &occ, const size_t *C,
+    backward_step_buffers<index_type> &buffers, ranges::basic_range_vector<index_type> &I2) {
+  typedef ranges::basic_range<index_type> range;
+
+  I2.clear();
+  if (letters.empty()) {
+    return;
+  }
 
-  size_t freq = 0; // sum_{k = 0 .. i - 1}C[k]
-  for (size_t i = 0; i <= alpha_size; ++i) {
-    size_t t = C[i];
-    C[i] = freq;
-    freq += t;
+  // une seule suite : elle est écrite directement dans I2
+  bool several = letters.size() > 1;
+  if (several) {
+    for (int i : letters) {
+      buffers.runs[i].clear();
+    }
+  }
+
+  auto first = I.begin();
+  while (first != I.end()) {
+    auto last = I.end() - first > (std::ptrdiff_t) rank_batch_size ? first + rank_batch_size : I.end();
+    std::size_t count = 0;
+    for (auto it = first; it != last; ++it) {
+      buffers.positions[count++] = it->get_low();
+      buffers.positions[count++] = it->get_high() + 1;
+      occ.prefetch(it->get_low());
+      occ.prefetch(it->get_high() + 1);
+    }
+    for (int i : letters) {
+      ranges::basic_range_vector<index_type> &run = several ? buffers.runs[i] : I2;
+      occ.rank_batch(i, buffers.positions.data(), count, buffers.ranks.data());
+      for (std::size_t k = 0; k < count; k += 2) {
+        size_t r1 = buffers.ranks[k];
+        size_t r2 = buffers.ranks[k + 1];
+        if (r1 < r2) {
+          run.push_back(range(C[i] + r1, C[i] + r2 - 1));
+        }
+      }
+    }
+    first = last;
+  }
+
+  if (several) {
+    for (int i : letters) {
+      I2.append(buffers.runs[i]);
+    }
   }
 }
 
 /**
- * Retourne le nombre de fois où la lettre c est apparue dans bwt[0 .. i - 1]
- * Implémentation naïve, comment faire en O(1) sans prendre plus de O(n) espace supplémentaire ?
- * Diffère légèrement de la définition de Thierry où il prend bwt[0 .. i]
+ * Un ranges::basic_adaptive_frontier passe en vecteur de bits quand il a plus d'un intervalle
+ * pour bitmap_density lignes de la BWT, et revient aux intervalles quand il en a moins
+ * d'un pour 4 * bitmap_density lignes
  */
-template<typename letter_type>
-size_t rank(int c, const buffer::buffer<letter_type> &bwt, size_t i) {
-  size_t count = 0;
-  size_t j = 0;
-  while (j < i) {
-    count += bwt[j] == c;
-    ++j;
-  }
-  return count;
+const std::size_t bitmap_density = 256;
+
+/**
+ * Bits de x aux positions des bits à 1 de mask, regroupés en poids faible (pext)
+ */
+inline std::uint64_t extract_bits(std::uint64_t x, std::uint64_t mask) {
+#ifdef __BMI2__
+  return _pext_u64(x, mask);
+#else
+  std::uint64_t r = 0;
+  for (std::uint64_t selected = x & mask; selected != 0; selected &= selected - 1) {
+    std::uint64_t bit = selected & (~selected + 1);
+    r |= 1ULL << __builtin_popcountll(mask & (bit - 1));
+  }
+  return r;
+#endif
 }
 
 /**
- * Retourne C tel que C[i] = |bwt|_i (nombre de i dans bwt, , 0 <= i < alpha_size)
- * C[alpha_size] est indéfini
- * En entrée C doit être initialisé à 0
+ * Étape de la recherche arrière sur un ensemble adaptatif de lignes.
+ * Tant que l'ensemble est formé de peu d'intervalles, l'étape est celle des
+ * ranges::basic_range_vector. Au-delà, elle parcourt le vecteur de bits des lignes mot par mot :
+ * pour une lettre c, les lignes d'un mot qui portent c sont envoyées par LF sur des lignes
+ * consécutives du bucket de c, à partir de C[c] + rank(c, 64 * w). Les bits de ces lignes
+ * (extract_bits avec le masque occ.letter_mask(c, w)) sont donc recopiés tels quels, et le rang
+ * avance du nombre de c du mot. Les mots vides sont sautés, le rang étant alors recalculé.
  */
-template<typename letter_type>
-void get_freq(const buffer::buffer<letter_type> &bwt, size_t *C) {
-  for (size_t i = 0; i < bwt.length(); ++i) {
-    ++C[ (size_t) bwt[i] ];
+template<typename index_type, class occ_type>
+void degenerate_backward_step(const ranges::basic_adaptive_frontier<index_type> &I,
+    const std::vector<int> &letters, const occ_type &occ, const size_t *C,
+    backward_step_buffers<index_type> &buffers, ranges::basic_adaptive_frontier<index_type> &I2) {
+  const std::size_t n = occ.size();
+  if (!I.is_bitmap() && I.num_intervals() <= n / bitmap_density) {
+    I2.clear();
+    degenerate_backward_step(I.get_ranges(), letters, occ, C, buffers, I2.get_ranges());
+    return;
+  }
+
+  const std::size_t num_words = (n + 63) / 64;
+  const std::uint64_t *rows = I.words();
+  if (!I.is_bitmap()) {
+    buffers.bitmap.assign(num_words, 0);
+    I.fill_bitmap(buffers.bitmap.data());
+    rows = buffers.bitmap.data();
+  }
+
+  I2.start_bitmap(n);
+  std::uint64_t *out = I2.words();
+  for (int c : letters) {
+    std::size_t r = 0; // rank(c, 64 * w)
+    std::size_t next_word = 0; // mot pour lequel r est à jour
+    for (std::size_t w = 0; w < num_words; ++w) {
+      if (rows[w] == 0) {
+        continue;
+      }
+      if (w != next_word) {
+        r = occ.rank(c, 64 * w);
+      }
+      std::uint64_t mask = occ.letter_mask(c, w);
+      std::uint64_t selected = extract_bits(rows[w], mask);
+      if (selected != 0) {
+        std::size_t p = C[c] + r;
+        out[p / 64] |= selected << (p % 64);
+        if (p % 64 + __builtin_popcountll(mask) > 64) {
+          out[p / 64 + 1] |= selected >> (64 - p % 64);
+        }
+      }
+      r += __builtin_popcountll(mask);
+      next_word = w + 1;
+    }
   }
+  I2.finish_bitmap(n / (4 * bitmap_density));
 }
 
-template<typename letter_index_type, class multi_letter_type>
-ranges::range_tree degenerate_backward_search_in_bwt2(
+/**
+ * Recherche arrière du motif dégénéré x, frontier_type étant la structure qui stocke
+ * les intervalles courants : ranges::basic_range_tree, std::list ou ranges::basic_range_vector.
+ * Deux frontières sont utilisées alternativement d'une étape à l'autre.
+ *
+ * occ_type : structure de rang sur la BWT, occ.rank(c, i) est le nombre de c dans bwt[0 .. i - 1]
+ * (voir idx::compact_rank)
+ * C : début des buckets de la BWT, calculé une fois pour toutes avec get_bucket_start
+ * (alpha_bwt.size() + 1 valeurs, voir preproc_backward_search2::C)
+ */
+template<class frontier_type, typename letter_index_type, class multi_letter_type, class occ_type>
+frontier_type degenerate_backward_search_frontier(
     const buffer::buffer<letter_index_type> &x, const std::vector<multi_letter_type > &alpha_x,
-    const buffer::buffer<letter_index_type> &bwt, const sdsl::rank_support_v<> *rs,
+    const occ_type &occ, const size_t *C,
     const std::vector<multi_letter_type > &alpha_bwt) {
+  typedef typename frontier_type::value_type::value_type index_type;
   size_t m = x.length();
-  ranges::range_tree I;
-
-  size_t *C = new size_t[alpha_bwt.size() + 1](); // +1 pour pouvoir écrire range(C[c], C[c + 1] - 1) même quand c est la dernière lettre
-
-  get_bucket_start(bwt, C, alpha_bwt.size());
-  /*
-  std::cerr << "C : " << std::endl;
-  for (size_t i = 0; i < alpha_bwt.size(); ++i) {
-    std::cerr << "C[" << i << "] = " << C[i] << " ";
-  }
-  std::cout << std::endl;
-   */
 
   assert(m > 0);
 
-  //std::cerr << "Initialisation..." << std::endl;
-  //std::cerr << "x[m - 1] = " << alpha_x[ x[m - 1] ] << std::endl;
-  for (int i = 0; i < (int) alpha_bwt.size(); ++i) {
-    //std::cerr << "c = " << alpha_bwt[i] << std::endl;
-    if (alpha_bwt[i].contains_some_letters(alpha_x[ x[m - 1] ])) {
-      size_t r1 = C[i];
-      size_t r2 = C[i + 1];
-      if (r1 < r2) {
-        //std::cerr << "Insert " << ranges::range(r1, r2 - 1) << std::endl;
-        I.insert(ranges::range(r1, r2 - 1));
-      }
-    }
-  }
+  compatible_letter_table compatible(alpha_x, C, alpha_bwt);
+
+  frontier_type I;
+  degenerate_backward_start(compatible[ x[m - 1] ], C, I);
 
   size_t k = m - 1;
   // size_t n'est pas signé, on ne peut donc écrire while (k >= 0) ...
   // on met donc une boucle do while au lieu d'un while
   if (I.empty() || k == 0) {
-    delete[] C;
-    return std::move(I);
+    return I;
   }
 
-  ranges::range_tree I2;
+  backward_step_buffers<index_type> buffers(alpha_bwt.size());
+  frontier_type I2;
   do {
     --k;
-    I2 = ranges::range_tree();
-
 //    std::cerr << "Boucle k = " << k << "..." << std::endl;
-//    std::cerr << "Taille de I: " << I.get_num_nodes() << std::endl;
-    for (auto r : I) {
-      //std::cerr << "r : " << r << std::endl;
-      for (int i = 0; i < (int) alpha_bwt.size(); ++i) {
-        auto c = alpha_bwt[i];
-        if (c.contains_some_letters(alpha_x[ x[k] ])) {
-          size_t r1 = rs[i](r.get_low());
-          size_t r2 = rs[i](r.get_high() + 1);
-
-//          std::cerr << "c : " << c << std::endl;
-//          std::cerr << "C[" << c << "] = " << C[i] << std::endl;
-//          std::cerr << "rank('" << c << "', bwt, " << r.get_low() << ") : " << r1 << std::endl;
-//          std::cerr << "rank('" << c << "', bwt, " << r.get_high() + 1 << ") : " << r2 << std::endl;
-          if (r1 < r2) {
-            //std::cerr << "Insert [" << C[c] + r1 << ", " << C[c] + r2 - 1<< "]" << std::endl;
-            I2.insert(ranges::range(C[i] + r1, C[i] + r2 - 1));
-          }
-        }
-      }
-    }
-
-    I = std::move(I2);
+    degenerate_backward_step(I, compatible[ x[k] ], occ, C, buffers, I2);
+    std::swap(I, I2);
 //    std::cerr << "I : " << std::endl;
 //    for (auto r : I) {
 //      std::cerr << "[" << r.get_low() << ", " << r.get_high() << "]" << std::endl;
@@ -278,128 +453,656 @@ ranges::range_tree degenerate_backward_search_in_bwt2(
 
   } while (!I.empty() && k > 0);
 
-  delete[] C;
-  return std::move(I);
+  return I;
 }
 
-template<typename letter_index_type, class multi_letter_type>
-std::list<ranges::range> degenerate_backward_search_in_bwt3(
+/**
+ * index_type : type des bornes des intervalles, doit pouvoir représenter la longueur de la BWT
+ * Les intervalles sont stockés dans un arbre rouge-noir
+ */
+template<typename index_type = std::int32_t, typename letter_index_type, class multi_letter_type, class occ_type>
+ranges::basic_range_tree<index_type> degenerate_backward_search_in_bwt2(
     const buffer::buffer<letter_index_type> &x, const std::vector<multi_letter_type > &alpha_x,
-    const buffer::buffer<letter_index_type> &bwt, const sdsl::rank_support_v<> *rs,
+    const occ_type &occ, const size_t *C,
     const std::vector<multi_letter_type > &alpha_bwt) {
-  size_t m = x.length();
-  std::list<ranges::range> I;
+  return degenerate_backward_search_frontier<ranges::basic_range_tree<index_type> >(x, alpha_x, occ, C, alpha_bwt);
+}
+
+/**
+ * Les intervalles sont stockés dans une liste, sans fusion des intervalles adjacents
+ */
+template<typename index_type = std::int32_t, typename letter_index_type, class multi_letter_type, class occ_type>
+std::list<ranges::basic_range<index_type> > degenerate_backward_search_in_bwt3(
+    const buffer::buffer<letter_index_type> &x, const std::vector<multi_letter_type > &alpha_x,
+    const occ_type &occ, const size_t *C,
+    const std::vector<multi_letter_type > &alpha_bwt) {
+  return degenerate_backward_search_frontier<std::list<ranges::basic_range<index_type> > >(x, alpha_x, occ, C, alpha_bwt);
+}
 
-  size_t *C = new size_t[alpha_bwt.size() + 1](); // +1 pour pouvoir écrire range(C[c], C[c + 1] - 1) même quand c est la dernière lettre
+/**
+ * Les intervalles sont stockés triés dans un tableau (voir ranges::basic_range_vector)
+ */
+template<typename index_type = std::int32_t, typename letter_index_type, class multi_letter_type, class occ_type>
+ranges::basic_range_vector<index_type> degenerate_backward_search_in_bwt4(
+    const buffer::buffer<letter_index_type> &x, const std::vector<multi_letter_type > &alpha_x,
+    const occ_type &occ, const size_t *C,
+    const std::vector<multi_letter_type > &alpha_bwt) {
+  return degenerate_backward_search_frontier<ranges::basic_range_vector<index_type> >(x, alpha_x, occ, C, alpha_bwt);
+}
 
-  get_bucket_start(bwt, C, alpha_bwt.size());
-  /*
-  std::cerr << "C : " << std::endl;
-  for (size_t i = 0; i < alpha_bwt.size(); ++i) {
-    std::cerr << "C[" << i << "] = " << C[i] << " ";
+/**
+ * occ_type : structure de rang sur la BWT (idx::compact_rank ou, pour un texte
+ * sur ACGT, idx::dna_occ)
+ */
+template<typename letter_index_type, class multi_letter_type, class occ_type = idx::compact_rank>
+class preproc_backward_search2 {
+public:
+  static const std::size_t locate_batch_size = 16; // lignes remontées ensemble par locate_range
+
+  /**
+   * text peut être formé de plusieurs séquences séparées par des 0 (voir idx::sequence_table),
+   * de noms names (vide si elles n'ont pas de nom).
+   * sa_sample_rate : seules les valeurs SA[i] à une distance multiple de sa_sample_rate du début
+   * de leur séquence sont conservées (1 pour conserver toute la table des suffixes), les autres
+   * sont retrouvées par locate().
+   * Avec sa_sample_rate = 0, la BWT est construite directement (saisxx_bwt) sans garder
+   * aucune valeur de la table des suffixes : l'index ne permet alors que de compter les
+   * occurrences (voir has_suffix_array).
+   * kmer_length : longueur des mots de la table des intervalles des k-mots (voir idx::kmer_table),
+   * 0 pour ne pas construire de table. La table demande un texte sur ACGT.
+   * bidirectional : construit aussi occ_rev, la structure de rang sur la BWT du texte retourné,
+   * pour la recherche bidirectionnelle (voir bidirectional_search.hpp).
+   * with_text : conserve une copie du texte sur 2 bits par lettre (idx::packed_text), pour
+   * vérifier directement les motifs autour des occurrences localisées (voir batch_search).
+   * Demande un texte sur ACGT.
+   * num_threads : threads de construction. Au-delà de 1, la table des suffixes est triée par
+   * idx::parallel_suffix_sort au lieu de saisxx (plus de mémoire), la BWT et l'échantillon
+   * de la table des suffixes sont remplis ensemble par tranches, et occ est construit en parallèle.
+   * max_memory : si non nul, la BWT est construite par blocs sur disque (voir idx::build_bwt_external)
+   * avec au plus max_memory octets de mémoire de travail, dans des fichiers temporaires nommés
+   * à partir de temp_prefix ; la table des suffixes entière n'est jamais en mémoire.
+   */
+  preproc_backward_search2(const buffer::buffer<letter_index_type> &text, const std::vector<multi_letter_type > &alpha_text,
+      std::size_t sa_sample_rate = 32, std::size_t kmer_length = 0, bool bidirectional = false, bool with_text = false,
+      unsigned int num_threads = 1, std::size_t max_memory = 0, const std::string &temp_prefix = std::string(),
+      const std::vector<std::string> &names = std::vector<std::string>())
+      : alpha_size(alpha_text.size()), sa_sample_rate(sa_sample_rate) {
+    if (num_threads == 0) {
+      num_threads = 1;
+    }
+    C = buffer::buffer<size_t>(alpha_size + 1); // +1 pour pouvoir écrire range(C[c], C[c + 1] - 1) même quand c est la dernière lettre
+    std::fill(C.data(), C.data() + alpha_size + 1, 0);
+    sequences = idx::sequence_table(idx::sequence_table::sequence_lengths(text.data(), text.length()), names,
+        sa_sample_rate);
+
+    if (max_memory > 0) {
+      std::string bwt_file = idx::build_bwt_external<occ_type>(text, alpha_size,
+          has_suffix_array() ? &sequences : nullptr, max_memory, temp_prefix, num_threads, sampled, SA_samples);
+      if (has_suffix_array()) {
+        sdsl::util::assign(sampled_rank, sdsl::rank_support_v<>(&sampled));
+      }
+      build_occ_from_file(bwt_file, occ, C.data(), num_threads);
+      std::remove(bwt_file.c_str());
+    } else {
+      // La BWT n'est conservée que le temps de construire occ et C
+      buffer::buffer<unsigned char> bwt(text.length());
+
+      // La table des suffixes n'est que temporaire : on utilise des entiers
+      // 32 bits quand c'est possible pour diviser par deux la mémoire nécessaire
+      if (fits_index_type<std::int32_t>(text.length())) {
+        build_bwt<std::int32_t>(text, bwt, num_threads);
+      } else {
+        build_bwt<std::int64_t>(text, bwt, num_threads);
+      }
+      occ = occ_type(bwt, alpha_size, num_threads);
+      get_bucket_start(bwt, C.data(), alpha_size);
+    }
+
+    if (kmer_length > 0) {
+      for (std::size_t c = 0; c < alpha_size; ++c) {
+        if (c != 0 && c != 1 && c != 2 && c != 4 && c != 8 && C[c] < C[c + 1]) {
+          throw std::runtime_error("the k-mer table needs a text over ACGT");
+        }
+      }
+      kmers = idx::kmer_table(occ, C.data(), kmer_length);
+    }
+
+    if (bidirectional) {
+      // le texte retourné a les mêmes lettres : C est aussi le début des buckets de sa BWT
+      build_reverse_occ(text, num_threads, max_memory, temp_prefix + ".rev");
+    }
+
+    if (with_text) {
+      this->text = idx::packed_text(text);
+    }
   }
-  std::cout << std::endl;
+
+  /**
+   * Charge un index construit par "dsbwt index" (voir idx::index_format.h).
+   * Le fichier est projeté en mémoire et ses tableaux bruts (C, les blocs de idx::dna_occ,
+   * l'échantillon de la table des suffixes, la table des k-mots et la copie du texte) sont
+   * utilisés en place : les processus qui cherchent dans le même index en partagent les pages.
+   * Les structures de sdsl (idx::compact_rank, sampled et son rank), les séquences et le tableau
+   * des documents sont recopiés.
+   * Si with_suffix_array est faux, l'échantillon de la table des suffixes, la copie du texte et
+   * le tableau des documents, rangés en fin de fichier, ne sont pas lus : seul le comptage des
+   * occurrences est possible.
    */
+  preproc_backward_search2(const std::string &index_file, bool with_suffix_array = true)
+      : mapping(new idx::mapped_file(index_file)) {
+    idx::mapped_reader reader(*mapping);
+    std::istream &in = reader.stream();
+
+    idx::check_header(in);
+    if (idx::read_value<std::uint64_t>(in) != occ_type::kind) {
+      throw std::runtime_error("index file built with another rank structure");
+    }
+    idx::read_value<std::uint64_t>(in); // longueur du texte, voir size()
+    alpha_size = idx::read_value<std::uint64_t>(in);
+    sa_sample_rate = idx::read_value<std::uint64_t>(in);
 
-  assert(m > 0);
+    idx::skip_padding(in);
+    C = buffer::buffer<size_t>::view(alpha_size + 1, reader.array<size_t>(alpha_size + 1));
 
-  //std::cerr << "Initialisation..." << std::endl;
-  //std::cerr << "x[m - 1] = " << alpha_x[ x[m - 1] ] << std::endl;
-  for (int i = 0; i < (int) alpha_bwt.size(); ++i) {
-    //std::cerr << "c = " << alpha_bwt[i] << std::endl;
-    if (alpha_bwt[i].contains_some_letters(alpha_x[ x[m - 1] ])) {
-      size_t r1 = C[i];
-      size_t r2 = C[i + 1];
-      if (r1 < r2) {
-        //std::cerr << "Insert " << ranges::range(r1, r2 - 1) << std::endl;
-        I.push_back(ranges::range(r1, r2 - 1));
+    occ.load(reader);
+    kmers.load(reader);
+    if (idx::read_value<std::uint64_t>(in) != 0) {
+      occ_rev.load(reader);
+    }
+    sequences.load(in);
+    if (with_suffix_array) {
+      sampled.load(in);
+      sampled_rank.load(in, &sampled);
+      SA_samples.load(reader);
+      if (idx::read_value<std::uint64_t>(in) != 0) {
+        text.load(reader);
       }
+      if (idx::read_value<std::uint64_t>(in) != 0) {
+        documents.load(in);
+      }
+    } else {
+      sa_sample_rate = 0;
+    }
+    if (!in) {
+      throw std::runtime_error("truncated index file");
     }
   }
 
-  size_t k = m - 1;
-  // size_t n'est pas signé, on ne peut donc écrire while (k >= 0) ...
-  // on met donc une boucle do while au lieu d'un while
-  if (I.empty() || k == 0) {
-    delete[] C;
-    return std::move(I);
+  /**
+   * Ajoute à l'index les séquences de new_text (séparées par des 0 et terminées par un 0,
+   * voir idx::sequence_table), de noms names, sans le reconstruire : l'index devient celui de
+   * new_text suivi du texte indexé, le dernier 0 de new_text séparant les deux, et les positions
+   * de l'ancien texte sont décalées de la longueur de new_text. Placé devant, le nouveau texte
+   * laisse intacts les suffixes de l'ancien et leur ordre, et ses suffixes sont insérés dans la BWT
+   * existante comme un bloc de idx::build_bwt_external : les points d'insertion sont calculés avec
+   * occ, puis les anciennes lignes sont recopiées dans des fichiers temporaires nommés à partir de
+   * temp_prefix avec les nouvelles insérées à leur place. C, occ, l'échantillon de la table des
+   * suffixes, la table des k-mots et le tableau des documents sont ensuite reconstruits sur la
+   * BWT fusionnée ; le coût ne dépend donc que linéairement de la longueur de l'ancien texte,
+   * au lieu du tri de tous ses suffixes.
+   * L'échantillon étant fixé séquence par séquence, les anciens échantillons restent valables :
+   * seuls leurs numéros sont décalés du nombre d'échantillons des nouvelles séquences.
+   * max_memory : si non nul, new_text est inséré par blocs d'au plus max_memory octets de mémoire
+   * de travail (external_bytes_per_position octets par lettre), sinon en une seule fois.
+   * L'index doit avoir un échantillon de la table des suffixes. Un index bidirectionnel doit
+   * avoir la copie du texte, qui sert à reconstruire occ_rev : l'ancien texte est alors lu
+   * en entier (le texte retourné ne peut pas être complété sur place).
+   */
+  void append(const buffer::buffer<letter_index_type> &new_text, unsigned int num_threads = 1,
+      std::size_t max_memory = 0, const std::string &temp_prefix = std::string(),
+      const std::vector<std::string> &names = std::vector<std::string>()) {
+    if (!has_suffix_array()) {
+      throw std::runtime_error("cannot append to an index without suffix array");
+    }
+    if (has_reverse_occ() && !has_text()) {
+      throw std::runtime_error("cannot append to a bidirectional index without a copy of the text");
+    }
+    if (num_threads == 0) {
+      num_threads = 1;
+    }
+    const std::size_t m = new_text.length();
+    if (m < 2 || new_text[m - 1] != 0) {
+      throw std::runtime_error("the appended text must end with a 0");
+    }
+    for (std::size_t i = 0; i < m; ++i) {
+      if (new_text[i] >= alpha_size) {
+        throw std::runtime_error("invalid letter in the appended text");
+      }
+      if ((kmers.get_k() > 0 || has_text()) && new_text[i] != 0 && new_text[i] != 1 && new_text[i] != 2
+          && new_text[i] != 4 && new_text[i] != 8) {
+        throw std::runtime_error("the k-mer table and the copy of the text need a text over ACGT");
+      }
+    }
+
+    // nouvelles séquences, puis les anciennes
+    std::vector<std::size_t> lengths = idx::sequence_table::sequence_lengths(new_text.data(), m);
+    const std::size_t num_new = lengths.size();
+    std::vector<std::string> all_names;
+    if (!names.empty() || sequences.has_names()) {
+      all_names = names;
+      all_names.resize(num_new);
+    }
+    for (std::size_t k = 0; k < sequences.size(); ++k) {
+      lengths.push_back(sequences.length(k));
+      if (!all_names.empty()) {
+        all_names.push_back(sequences.has_names() ? sequences.name(k) : std::string());
+      }
+    }
+    idx::sequence_table old_sequences = sequences;
+    sequences = idx::sequence_table(lengths, all_names, sa_sample_rate);
+    const std::size_t n = sequences.text_length();
+    const std::size_t shift = sequences.num_samples() - old_sequences.num_samples(); // ajouté aux anciens numéros
+    idx::position_sampler sampler(sequences);
+
+    // BWT et échantillons actuels, la ligne r0 de la position 0 portant le 0
+    const idx::external_bwt_files files[2] = { idx::external_bwt_files(temp_prefix + ".0"),
+        idx::external_bwt_files(temp_prefix + ".1") };
+    std::size_t r0 = 0;
+    {
+      idx::external_bwt_writer writer(files[0], &sampler);
+      for (std::size_t i = 0, j = 0; i < size(); ++i) {
+        letter_index_type c = occ.access(i);
+        if (c == 0 && sampled[i] && SA_samples[j] == 0) {
+          r0 = i; // la ligne 0 du texte est la seule dont l'échantillon est le premier
+        }
+        writer.write_row(c, sampled[i], sampled[i] ? SA_samples[j++] + shift : 0);
+      }
+      writer.close();
+    }
+    std::vector<std::size_t> counts(alpha_size);
+    for (std::size_t c = 0; c < alpha_size; ++c) {
+      counts[c] = C[c + 1] - C[c];
+    }
+    const std::size_t block_size = max_memory > 0 ?
+        std::max<std::size_t>(1, max_memory / idx::external_bytes_per_position) : m;
+    int current = idx::prepend_bwt_blocks<occ_type>(new_text.data(), m, alpha_size, &sampler, block_size, &occ,
+        files, 0, counts, r0, num_threads);
+
+    idx::load_external_samples(files[current], n, true, sampled, SA_samples);
+    sdsl::util::assign(sampled_rank, sdsl::rank_support_v<>(&sampled));
+    // C peut être lu en place dans le fichier de l'index : il est remplacé par une copie,
+    // remplie par get_bucket_start qui y compte les lettres
+    C = buffer::buffer<size_t>(alpha_size + 1);
+    std::fill(C.data(), C.data() + alpha_size + 1, 0);
+    build_occ_from_file(files[current].bwt, occ, C.data(), num_threads);
+    std::remove(files[current].bwt.c_str());
+
+    if (kmers.get_k() > 0) {
+      kmers = idx::kmer_table(occ, C.data(), kmers.get_k());
+    }
+    if (has_documents()) {
+      build_documents();
+    }
+
+    if (has_text()) {
+      // les séparateurs de l'ancien texte précèdent les débuts de ses séquences
+      buffer::buffer<letter_index_type> full(n);
+      std::copy(new_text.data(), new_text.data() + m, full.data());
+      for (std::size_t i = 0; i < text.size(); ++i) {
+        full[m + i] = old_sequences.is_start(i + 1) ? 0 : text[i];
+      }
+      full[n - 1] = 0;
+      if (has_reverse_occ()) {
+        build_reverse_occ(full, num_threads, max_memory, temp_prefix + ".rev");
+      }
+      text = idx::packed_text(full);
+    }
   }
 
-  std::list<ranges::range> I2;
-  do {
-    --k;
-    I2 = std::list<ranges::range>();
-
-    //std::cerr << "Boucle k = " << k << "..." << std::endl;
-    for (auto r : I) {
-      //std::cerr << "r : " << r << std::endl;
-      for (int i = 0; i < (int) alpha_bwt.size(); ++i) {
-        auto c = alpha_bwt[i];
-        if (c.contains_some_letters(alpha_x[ x[k] ])) {
-          size_t r1 = rs[i](r.get_low());
-          size_t r2 = rs[i](r.get_high() + 1);
-
-//          std::cerr << "c : " << c << std::endl;
-//          std::cerr << "C[" << c << "] = " << C[i] << std::endl;
-//          std::cerr << "rank('" << c << "', bwt, " << r.get_low() << ") : " << r1 << std::endl;
-//          std::cerr << "rank('" << c << "', bwt, " << r.get_high() + 1 << ") : " << r2 << std::endl;
-          if (r1 < r2) {
-            //std::cerr << "Insert [" << C[c] + r1 << ", " << C[c] + r2 - 1<< "]" << std::endl;
-            I2.push_back(ranges::range(C[i] + r1, C[i] + r2 - 1));
+  /**
+   * L'index doit avoir été construit avec un échantillon de la table des suffixes
+   */
+  void serialize(std::ostream &out) const {
+    assert(has_suffix_array());
+    idx::write_header(out);
+    idx::write_value<std::uint64_t>(out, occ_type::kind);
+    idx::write_value<std::uint64_t>(out, size());
+    idx::write_value<std::uint64_t>(out, alpha_size);
+    idx::write_value<std::uint64_t>(out, sa_sample_rate);
+    idx::write_padding(out);
+    idx::write_array(out, C.data(), alpha_size + 1);
+    occ.serialize(out);
+    kmers.serialize(out);
+    idx::write_value<std::uint64_t>(out, has_reverse_occ());
+    if (has_reverse_occ()) {
+      occ_rev.serialize(out);
+    }
+    sequences.serialize(out);
+    sampled.serialize(out);
+    sampled_rank.serialize(out);
+    SA_samples.serialize(out);
+    idx::write_value<std::uint64_t>(out, has_text());
+    if (has_text()) {
+      text.serialize(out);
+    }
+    idx::write_value<std::uint64_t>(out, has_documents());
+    if (has_documents()) {
+      documents.serialize(out);
+    }
+  }
+
+  /**
+   * Retourne SA[i] : on applique LF depuis la ligne i jusqu'à tomber sur
+   * une ligne échantillonnée, ce qui demande au plus sa_sample_rate - 1 étapes.
+   * Le début de chaque séquence est échantillonné, on ne rencontre donc jamais
+   * une lettre 0 (séparateur ou 0 final, voir idx::sequence_table).
+   * Demande un échantillon de la table des suffixes (voir has_suffix_array).
+   */
+  std::size_t locate(std::size_t i) const {
+    assert(has_suffix_array());
+    std::size_t steps = 0;
+    while (!sampled[i]) {
+      letter_index_type c = occ.access(i);
+      i = C[c] + occ.rank(c, i);
+      ++steps;
+    }
+    return sequences.sample_position(SA_samples[sampled_rank(i)]) + steps;
+  }
+
+  /**
+   * Ajoute à positions SA[low], ..., SA[high] (voir locate).
+   * Les lignes sont remontées ensemble, par paquets de locate_batch_size, et le chargement
+   * des blocs lus à l'étape suivante est demandé à l'avance : les défauts de cache des
+   * différentes lignes se recouvrent au lieu de s'enchaîner.
+   */
+  void locate_range(std::size_t low, std::size_t high, std::vector<std::size_t> &positions) const {
+    assert(has_suffix_array());
+    std::size_t rows[locate_batch_size];
+    std::size_t steps[locate_batch_size];
+    std::size_t active[locate_batch_size]; // indices des lignes pas encore échantillonnées
+    for (std::size_t first = low; first <= high; first += locate_batch_size) {
+      std::size_t count = std::min(locate_batch_size, high - first + 1);
+      std::size_t out = positions.size();
+      positions.resize(out + count);
+      for (std::size_t k = 0; k < count; ++k) {
+        rows[k] = first + k;
+        steps[k] = 0;
+        active[k] = k;
+      }
+      std::size_t num_active = count;
+      while (num_active > 0) {
+        std::size_t a = 0;
+        for (std::size_t t = 0; t < num_active; ++t) {
+          std::size_t k = active[t];
+          std::size_t i = rows[k];
+          if (sampled[i]) {
+            positions[out + k] = sequences.sample_position(SA_samples[sampled_rank(i)]) + steps[k];
+            continue;
           }
+          letter_index_type c = occ.access(i);
+          i = C[c] + occ.rank(c, i);
+          occ.prefetch(i);
+          __builtin_prefetch(sampled.data() + i / 64);
+          rows[k] = i;
+          ++steps[k];
+          active[a++] = k;
         }
+        num_active = a;
       }
     }
+  }
 
-    I = std::move(I2);
-//    std::cerr << "I : " << std::endl;
-//    for (auto r : I) {
-//      std::cerr << "[" << r.get_low() << ", " << r.get_high() << "]" << std::endl;
-//    }
+  /**
+   * Longueur de la BWT (texte compris son 0 final)
+   */
+  std::size_t size() const {
+    return occ.size();
+  }
 
-  } while (!I.empty() && k > 0);
+  /**
+   * Faux si l'index a été construit ou chargé sans table des suffixes :
+   * locate() n'est alors pas utilisable
+   */
+  bool has_suffix_array() const {
+    return sa_sample_rate != 0;
+  }
 
-  delete[] C;
-  return std::move(I);
-}
+  /**
+   * Vrai si l'index a été construit avec la BWT du texte retourné (occ_rev)
+   */
+  bool has_reverse_occ() const {
+    return occ_rev.size() > 0;
+  }
 
-template<typename letter_index_type, class multi_letter_type>
-class preproc_backward_search2 {
-public:
-  preproc_backward_search2(const buffer::buffer<letter_index_type> &text, const std::vector<multi_letter_type > &alpha_text) {
-    bwt = buffer::buffer<unsigned char>(text.length());
-    SA = new int[text.length()];
+  /**
+   * Vrai si l'index a une copie du texte (voir with_text)
+   */
+  bool has_text() const {
+    return !text.empty();
+  }
 
-    bbwt = new sdsl::bit_vector[alpha_text.size()];
-    for (std::size_t c = 0; c < alpha_text.size(); ++c) {
-      bbwt[c] = sdsl::bit_vector(text.length()); // + 1 ???
+  /**
+   * Vrai si l'index a un tableau des documents (voir build_documents)
+   */
+  bool has_documents() const {
+    return !documents.empty();
+  }
+
+  /**
+   * Construit le tableau des documents (voir idx::document_array), qui donne les séquences des
+   * occurrences d'un intervalle de la BWT sans les localiser.
+   * Les lignes de chaque séquence sont celles de LF remonté depuis la ligne du 0 qui la suit
+   * jusqu'à celle de son début, soit n étapes en tout. Les lignes des lettres 0 de la BWT sont
+   * celles des débuts des séquences, toutes échantillonnées ; les lignes 1 .. m - 1 sont celles
+   * des séparateurs, dans l'ordre des lignes des débuts des séquences 1 .. m - 1 qu'ils précèdent,
+   * et la ligne 0 celle du 0 final.
+   * Demande un échantillon de la table des suffixes.
+   */
+  void build_documents() {
+    if (!has_suffix_array()) {
+      throw std::runtime_error("the document array needs the suffix array");
+    }
+    const std::size_t m = sequences.size();
+    // start_rows[k] : ligne du début de la séquence k, trouvée par recherche dichotomique
+    // de la j-ième lettre 0 de la BWT
+    std::vector<std::size_t> start_rows(m);
+    for (std::size_t j = 0; j < m; ++j) {
+      std::size_t low = 0;
+      std::size_t high = size() - 1;
+      while (low < high) {
+        std::size_t mid = low + (high - low) / 2;
+        if (occ.rank(0, mid + 1) > j) {
+          high = mid;
+        } else {
+          low = mid + 1;
+        }
+      }
+      std::size_t p = sequences.sample_position(SA_samples[sampled_rank(low)]);
+      start_rows[sequences.sequence_at(p)] = low;
+    }
+    std::vector<std::size_t> order(m > 0 ? m - 1 : 0); // séquences 1 .. m - 1 par ligne de début
+    for (std::size_t k = 0; k < order.size(); ++k) {
+      order[k] = k + 1;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+      return start_rows[a] < start_rows[b];
+    });
+    std::vector<std::size_t> end_rows(m, 0); // ligne du 0 qui suit la séquence k
+    for (std::size_t r = 0; r < order.size(); ++r) {
+      end_rows[order[r] - 1] = r + 1;
     }
 
-    saisxx(text.data(), SA + 1, (int) text.length() - 1);
-    SA[0] = text.length() - 1;
-    for (size_t i = 0; i < text.length(); ++i) {
-      letter_index_type c = SA[i] == 0 ? 0 : text[SA[i] - 1];
-      bwt[i] = c;
-      bbwt[c][i] = 1;
+    sdsl::int_vector<> rows_documents(size(), 0, sdsl::bits::hi(std::max<std::size_t>(m, 1)) + 1);
+    for (std::size_t k = 0; k < m; ++k) {
+      std::size_t i = end_rows[k];
+      rows_documents[i] = k;
+      for (letter_index_type c = occ.access(i); c != 0; c = occ.access(i)) {
+        i = C[c] + occ.rank(c, i);
+        rows_documents[i] = k;
+      }
     }
-    rs = new sdsl::rank_support_v<>[alpha_text.size()];
-    for (std::size_t c = 0; c < alpha_text.size(); ++c) {
-  //    rs[c].init(&(bbwt[c]));
-      sdsl::util::assign(rs[c], sdsl::rank_support_v<>(&(bbwt[c])));
+    documents = idx::document_array(rows_documents);
+  }
+
+  /**
+   * Ajoute à out les séquences des occurrences des lignes low .. high et leur nombre
+   * d'occurrences (voir idx::document_array::list)
+   */
+  void list_documents(std::size_t low, std::size_t high,
+      std::vector<idx::document_array::document_count> &out) const {
+    documents.list(low, high, out);
+  }
+
+  std::size_t alpha_size;
+  std::size_t sa_sample_rate; // 0 si l'index n'a pas de table des suffixes
+  occ_type occ;
+  buffer::buffer<size_t> C; // C[c] : début du bucket de la lettre c dans la BWT, C[alpha_size] = size()
+  occ_type occ_rev; // structure de rang sur la BWT du texte retourné, vide si l'index n'est pas bidirectionnel
+  idx::kmer_table kmers; // vide (get_k() = 0) si l'index n'a pas de table des k-mots
+
+  idx::sequence_table sequences; // séquences du texte, qui fixent aussi les positions échantillonnées
+  sdsl::bit_vector sampled; // sampled[i] = 1 ssi SA[i] est une position échantillonnée (voir sequences)
+  sdsl::rank_support_v<> sampled_rank;
+  idx::packed_array SA_samples; // numéro de l'échantillon SA[i] pour les lignes échantillonnées
+  idx::packed_text text; // vide si l'index n'a pas de copie du texte
+  idx::document_array documents; // vide si l'index n'a pas de tableau des documents
+
+private:
+  preproc_backward_search2(const preproc_backward_search2 &pp);
+  preproc_backward_search2& operator=(const preproc_backward_search2 &pp);
+
+  template<typename sa_type>
+  void build_bwt(const buffer::buffer<letter_index_type> &text, buffer::buffer<unsigned char> &bwt,
+      unsigned int num_threads) {
+    if (!has_suffix_array()) {
+      build_bwt_only<sa_type>(text, bwt, alpha_size, num_threads);
+      return;
     }
+
+    sa_type *sa = new sa_type[text.length()];
+    if (num_threads > 1) {
+      idx::parallel_suffix_sort(text.data(), text.length(), alpha_size, sa, num_threads);
+    } else {
+      saisxx(text.data(), sa + 1, (sa_type) text.length() - 1, (sa_type) alpha_size);
+      sa[0] = text.length() - 1;
+    }
+    fill_bwt_and_samples(text, sa, bwt, num_threads);
+    delete[] sa;
   }
 
-  ~preproc_backward_search2() {
-//    std::cerr << "~preproc_backward_search2()" << std::endl;
-    delete[] SA;
-    delete[] bbwt;
-    delete[] rs;
+  /**
+   * Construit la BWT de text sans échantillonner la table des suffixes
+   */
+  template<typename sa_type>
+  static void build_bwt_only(const buffer::buffer<letter_index_type> &text, buffer::buffer<unsigned char> &bwt,
+      std::size_t alpha_size, unsigned int num_threads) {
+    sa_type *sa = new sa_type[text.length()];
+    if (num_threads > 1) {
+      idx::parallel_suffix_sort(text.data(), text.length(), alpha_size, sa, num_threads);
+      idx::parallel_chunks(text.length(), 1, num_threads, [&](unsigned int, std::size_t begin, std::size_t end) {
+        for (std::size_t i = begin; i < end; ++i) {
+          bwt[i] = sa[i] == 0 ? 0 : text[sa[i] - 1];
+        }
+      });
+      delete[] sa;
+      return;
+    }
+    // saisxx_bwt trie les suffixes de text sans son 0 final et n'écrit pas la lettre
+    // de la ligne du suffixe commençant en 0 : elle retourne la position p de cette
+    // ligne dans notre BWT, où l'on insère le 0 (la ligne 0 étant celle du 0 final)
+    sa_type n = text.length() - 1;
+    sa_type p = saisxx_bwt(const_cast<letter_index_type *>(text.data()), bwt.data(), sa, n, (sa_type) alpha_size);
+    delete[] sa;
+    for (sa_type i = n; i > p; --i) {
+      bwt[i] = bwt[i - 1];
+    }
+    bwt[p] = 0;
+  }
+
+  /**
+   * Construit occ_rev, la structure de rang sur la BWT du texte retourné
+   * (le 0 final restant à la fin)
+   */
+  void build_reverse_occ(const buffer::buffer<letter_index_type> &text, unsigned int num_threads,
+      std::size_t max_memory, const std::string &temp_prefix) {
+    buffer::buffer<letter_index_type> reversed(text.length());
+    for (std::size_t i = 0; i + 1 < text.length(); ++i) {
+      reversed[i] = text[text.length() - 2 - i];
+    }
+    reversed[text.length() - 1] = 0;
+
+    if (max_memory > 0) {
+      sdsl::bit_vector no_sampled;
+      idx::packed_array no_samples;
+      std::string bwt_file = idx::build_bwt_external<occ_type>(reversed, alpha_size, nullptr, max_memory,
+          temp_prefix, num_threads, no_sampled, no_samples);
+      build_occ_from_file(bwt_file, occ_rev, nullptr, num_threads);
+      std::remove(bwt_file.c_str());
+      return;
+    }
+
+    buffer::buffer<unsigned char> bwt(text.length());
+    if (fits_index_type<std::int32_t>(text.length())) {
+      build_bwt_only<std::int32_t>(reversed, bwt, alpha_size, num_threads);
+    } else {
+      build_bwt_only<std::int64_t>(reversed, bwt, alpha_size, num_threads);
+    }
+    occ_rev = occ_type(bwt, alpha_size, num_threads);
+  }
+
+  /**
+   * Construit r sur la BWT du fichier bwt_file, projeté en mémoire, et, si bucket_start
+   * n'est pas nul, y range le début des buckets de cette BWT
+   */
+  void build_occ_from_file(const std::string &bwt_file, occ_type &r, size_t *bucket_start, unsigned int num_threads) {
+    idx::mapped_file f(bwt_file);
+    buffer::buffer<unsigned char> bwt = buffer::buffer<unsigned char>::view(f.size(),
+        reinterpret_cast<const unsigned char *>(f.data()));
+    r = occ_type(bwt, alpha_size, num_threads);
+    if (bucket_start != nullptr) {
+      get_bucket_start(bwt, bucket_start, alpha_size);
+    }
+  }
+
+  /**
+   * Remplit la BWT à partir de la table des suffixes sa et l'échantillonne en un seul passage,
+   * par tranches de lignes alignées sur les mots de sampled. Les valeurs échantillonnées de chaque
+   * tranche sont rangées à leur place dans un tableau temporaire (le nombre d'échantillons des
+   * tranches précédentes étant connu après le passage), puis recopiées dans SA_samples.
+   */
+  template<typename sa_type>
+  void fill_bwt_and_samples(const buffer::buffer<letter_index_type> &text, const sa_type *sa,
+      buffer::buffer<unsigned char> &bwt, unsigned int num_threads) {
+    const std::size_t n = text.length();
+    idx::position_sampler sampler(sequences);
+    sampled = sdsl::bit_vector(n, 0);
+    std::vector<std::size_t> chunk_samples(num_threads, 0);
+    idx::parallel_chunks(n, 64, num_threads, [&](unsigned int t, std::size_t begin, std::size_t end) {
+      std::size_t count = 0;
+      for (std::size_t i = begin; i < end; ++i) {
+        bwt[i] = sa[i] == 0 ? 0 : text[sa[i] - 1];
+        if (sampler.contains(sa[i])) {
+          sampled[i] = 1;
+          ++count;
+        }
+      }
+      chunk_samples[t] = count;
+    });
+    sdsl::util::assign(sampled_rank, sdsl::rank_support_v<>(&sampled));
+
+    std::size_t num_samples = 0;
+    for (std::size_t &count : chunk_samples) {
+      std::size_t c = count;
+      count = num_samples; // premier échantillon de la tranche
+      num_samples += c;
+    }
+    std::vector<sa_type> samples(num_samples);
+    idx::parallel_chunks(n, 64, num_threads, [&](unsigned int t, std::size_t begin, std::size_t end) {
+      std::size_t j = chunk_samples[t];
+      for (std::size_t i = begin; i < end; ++i) {
+        if (sampler.contains(sa[i])) {
+          samples[j++] = sampler.number(sa[i]);
+        }
+      }
+    });
+
+    SA_samples = idx::packed_array(num_samples, sdsl::bits::hi(num_samples) + 1);
+    for (std::size_t j = 0; j < num_samples; ++j) {
+      SA_samples.set(j, samples[j]);
+    }
   }
 
-  buffer::buffer<letter_index_type> bwt;
-  int *SA;
-  sdsl::bit_vector *bbwt;
-  sdsl::rank_support_v<> *rs;
+  std::unique_ptr<idx::mapped_file> mapping; // fichier de l'index chargé, dont les tableaux sont lus en place
 };
 
 /**
@@ -417,12 +1120,12 @@ std::vector<std::size_t> degenerate_backward_search2(
   std::chrono::high_resolution_clock::time_point t1, t2;
   std::chrono::duration<double> time_span;
   t1 = std::chrono::high_resolution_clock::now();
-  ranges::range_tree result = degenerate_backward_search_in_bwt2(pattern, alpha_pattern, pp.bwt, pp.rs, alpha_text);
+  ranges::range_tree64 result = degenerate_backward_search_in_bwt2<std::int64_t>(pattern, alpha_pattern, pp.occ, pp.C.data(), alpha_text);
 
   std::vector<std::size_t> v = std::vector<std::size_t>();
   for (auto r : result) {
-    for (int p = r.get_low(); p <= r.get_high(); ++p) {
-      v.push_back(pp.SA[p]);
+    for (std::int64_t p = r.get_low(); p <= r.get_high(); ++p) {
+      v.push_back(pp.locate(p));
     }
   }
 
@@ -0,0 +1,85 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef SRC_DEGENERATE_SEARCH_PATTERN_TRIE_HPP_
+#define SRC_DEGENERATE_SEARCH_PATTERN_TRIE_HPP_
+
+#include "buffer/buffer.h"
+
+#include <map>
+#include <vector>
+
+/**
+ * Trie des motifs lus de droite à gauche (trie des suffixes communs des motifs),
+ * dans l'ordre où la recherche arrière consomme leurs lettres.
+ * Les arcs sont étiquetés par les multi-lettres (indices dans l'alphabet des motifs).
+ * Les motifs identiques aboutissent au même nœud : ils ne sont recherchés qu'une fois.
+ */
+template<typename letter_index_type>
+class pattern_trie {
+public:
+  struct node {
+    std::map<letter_index_type, std::size_t> children; // lettre -> indice du fils
+    std::vector<std::size_t> patterns; // motifs qui se terminent (à gauche) en ce nœud
+    std::size_t parent;
+    letter_index_type letter; // étiquette de l'arc depuis le père
+    std::size_t depth;
+  };
+
+  static const std::size_t root = 0;
+
+  explicit pattern_trie(const std::vector<buffer::buffer<letter_index_type> > &patterns) : nodes(1) {
+    nodes[root].parent = root;
+    nodes[root].letter = 0;
+    nodes[root].depth = 0;
+    for (std::size_t j = 0; j < patterns.size(); ++j) {
+      std::size_t v = root;
+      for (std::size_t k = patterns[j].length(); k > 0; --k) {
+        v = child(v, patterns[j][k - 1]);
+      }
+      nodes[v].patterns.push_back(j);
+    }
+  }
+
+  const node &operator[](std::size_t v) const {
+    return nodes[v];
+  }
+
+  std::size_t get_num_nodes() const {
+    return nodes.size();
+  }
+
+private:
+  std::size_t child(std::size_t v, letter_index_type l) {
+    auto it = nodes[v].children.find(l);
+    if (it != nodes[v].children.end()) {
+      return it->second;
+    }
+    std::size_t w = nodes.size();
+    nodes[v].children[l] = w;
+    nodes.push_back(node());
+    nodes[w].parent = v;
+    nodes[w].letter = l;
+    nodes[w].depth = nodes[v].depth + 1;
+    return w;
+  }
+
+  std::vector<node> nodes;
+};
+
+#endif /* SRC_DEGENERATE_SEARCH_PATTERN_TRIE_HPP_ */
@@ -0,0 +1,243 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef SRC_DEGENERATE_SEARCH_SPLIT_SEARCH_HPP_
+#define SRC_DEGENERATE_SEARCH_SPLIT_SEARCH_HPP_
+
+#include "buffer/buffer.h"
+#include "degenerate_search/degenerate_search.hpp"
+#include "degenerate_search/batch_search.hpp"
+#include "degenerate_search/bidirectional_search.hpp"
+#include "index/parallel.h"
+#include "trees/range_vector.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * Morceau d'un motif découpé par split_pattern : letters = x[offset .. offset + letters.length() - 1]
+ */
+struct pattern_piece {
+  std::size_t offset;
+  buffer::buffer<unsigned char> letters;
+};
+
+/**
+ * Découpe x aux plages d'au moins min_gap positions consécutives dont la lettre est
+ * un joker (wildcard[x[i]], compatible avec toutes les lettres du texte).
+ * Les plages plus courtes restent dans les morceaux. Un motif qui n'est fait que
+ * de jokers ne donne aucun morceau.
+ */
+inline std::vector<pattern_piece> split_pattern(const buffer::buffer<unsigned char> &x,
+    const std::vector<bool> &wildcard, std::size_t min_gap) {
+  std::vector<pattern_piece> pieces;
+  std::size_t begin = 0; // début du morceau courant
+  std::size_t i = 0;
+  while (i < x.length()) {
+    if (!wildcard[x[i]]) {
+      ++i;
+      continue;
+    }
+    std::size_t run = i;
+    while (i < x.length() && wildcard[x[i]]) {
+      ++i;
+    }
+    if (i - run >= min_gap) {
+      if (run > begin) {
+        pieces.push_back(pattern_piece { begin, buffer::buffer<unsigned char>(run - begin, x.data() + begin) });
+      }
+      begin = i;
+    }
+  }
+  if (x.length() > begin) {
+    pieces.push_back(pattern_piece { begin, buffer::buffer<unsigned char>(x.length() - begin, x.data() + begin) });
+  }
+  return pieces;
+}
+
+/**
+ * Recherche les motifs de patterns en les coupant aux plages d'au moins min_gap jokers
+ * (par exemple des N) : ces positions multiplient les intervalles de la recherche arrière
+ * par le nombre de lettres du texte sans rien filtrer.
+ * Chaque morceau (voir split_pattern) est recherché séparément, par recherche arrière ou,
+ * avec bidirectional, par bidirectional_search. Les morceaux sont ensuite localisés, du
+ * plus rare au plus fréquent, et joints par leur position dans le texte moins leur décalage
+ * dans le motif (intersection de listes triées) ; on s'arrête dès que la jointure est vide.
+ * Les occurrences qui couvrent un séparateur de séquences sont ensuite écartées.
+ * Un motif sans plage assez longue donne un seul morceau et le même résultat que batch_search.
+ * Avec by_document, les séquences des occurrences jointes remplacent leurs positions
+ * (voir count_documents) : les morceaux doivent de toute façon être localisés.
+ * Demande une table des suffixes (pp.has_suffix_array()). Le résultat j correspond au motif patterns[j].
+ */
+template<typename index_type, class preproc_type, class multi_letter_type>
+std::vector<pattern_result> split_batch_search(const preproc_type &pp,
+    const std::vector<buffer::buffer<unsigned char> > &patterns, const std::vector<multi_letter_type> &letters,
+    std::size_t min_gap, unsigned int num_threads = 1, bool bidirectional = false, bool by_document = false) {
+  typedef ranges::basic_range_vector<index_type> frontier;
+  if (!pp.has_suffix_array()) {
+    throw std::runtime_error("splitting patterns needs the suffix array");
+  }
+  if (bidirectional && !pp.has_reverse_occ()) {
+    throw std::runtime_error("the index has no reverse BWT, rebuild it with --bidirectional");
+  }
+
+  compatible_letter_table compatible(letters, pp.C.data(), letters);
+  std::size_t num_text_letters = 0;
+  for (std::size_t c = 1; c < letters.size(); ++c) {
+    if (pp.C[c] < pp.C[c + 1]) {
+      ++num_text_letters;
+    }
+  }
+  std::vector<bool> wildcard(letters.size());
+  for (std::size_t a = 0; a < letters.size(); ++a) {
+    wildcard[a] = compatible[a].size() == num_text_letters;
+  }
+  const std::size_t text_length = pp.size() - 1; // sans le 0 final
+
+  std::vector<pattern_result> results(patterns.size());
+
+  // tampons de chaque thread
+  struct thread_buffers {
+    explicit thread_buffers(std::size_t alpha_size) : buffers(alpha_size), bi_buffers(alpha_size) {
+    }
+
+    backward_step_buffers<index_type> buffers;
+    bidirectional_buffers<index_type> bi_buffers;
+    std::vector<bidirectional_range<index_type> > bi_intervals;
+    frontier I2;
+  };
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  std::vector<thread_buffers> all_buffers;
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    all_buffers.emplace_back(letters.size());
+  }
+
+  idx::parallel_thread_tasks(patterns.size(), num_threads, [&](unsigned int t, std::size_t j) {
+    backward_step_buffers<index_type> &buffers = all_buffers[t].buffers;
+    bidirectional_buffers<index_type> &bi_buffers = all_buffers[t].bi_buffers;
+    std::vector<bidirectional_range<index_type> > &bi_intervals = all_buffers[t].bi_intervals;
+    frontier &I2 = all_buffers[t].I2;
+    std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+
+    const buffer::buffer<unsigned char> &x = patterns[j];
+    pattern_result &result = results[j];
+    if (x.length() == 0 || x.length() > text_length) {
+      return; // pas d'occurrence, comme dans batch_search
+    }
+    const std::size_t last_start = text_length - x.length(); // dernière position possible d'une occurrence
+
+    // intervalles de chaque morceau
+    std::vector<pattern_piece> pieces = split_pattern(x, wildcard, min_gap);
+    std::vector<frontier> intervals(pieces.size());
+    std::vector<std::uint64_t> counts(pieces.size(), 0);
+    for (std::size_t k = 0; k < pieces.size(); ++k) {
+      const buffer::buffer<unsigned char> &y = pieces[k].letters;
+      frontier &I = intervals[k];
+      if (bidirectional) {
+        bidirectional_search(pp, y, compatible, bi_buffers, bi_intervals);
+        std::sort(bi_intervals.begin(), bi_intervals.end(),
+            [](const bidirectional_range<index_type> &a, const bidirectional_range<index_type> &b) {
+              return a.low < b.low;
+            });
+        for (const auto &r : bi_intervals) {
+          I.push_back(ranges::basic_range<index_type>(r.low, r.high));
+        }
+      } else {
+        degenerate_backward_start(compatible[y[y.length() - 1]], pp.C.data(), I);
+        for (std::size_t i = y.length() - 1; i > 0 && !I.empty(); --i) {
+          degenerate_backward_step(I, compatible[y[i - 1]], pp.occ, pp.C.data(), buffers, I2);
+          std::swap(I, I2);
+        }
+      }
+      for (auto r : I) {
+        counts[k] += (std::uint64_t) (r.get_high() - r.get_low()) + 1;
+      }
+    }
+
+    std::vector<std::size_t> order(pieces.size());
+    for (std::size_t k = 0; k < order.size(); ++k) {
+      order[k] = k;
+    }
+    std::sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) {
+      return counts[a] < counts[b];
+    });
+
+    // jointure des débuts d'occurrences des morceaux
+    std::vector<std::size_t> &starts = result.positions;
+    if (pieces.empty()) {
+      for (std::size_t k = 0; k < pp.sequences.size(); ++k) {
+        const std::size_t begin = pp.sequences.start(k);
+        const std::size_t length = pp.sequences.length(k);
+        for (std::size_t p = begin; p + x.length() <= begin + length; ++p) {
+          starts.push_back(p);
+        }
+      }
+    }
+    std::vector<std::size_t> located;
+    std::vector<std::size_t> piece_starts;
+    std::vector<std::size_t> joined;
+    for (std::size_t r = 0; r < order.size(); ++r) {
+      const pattern_piece &piece = pieces[order[r]];
+      located.clear();
+      for (auto range : intervals[order[r]]) {
+        pp.locate_range(range.get_low(), range.get_high(), located);
+      }
+      piece_starts.clear();
+      for (std::size_t pos : located) {
+        if (pos >= piece.offset && pos - piece.offset <= last_start) {
+          piece_starts.push_back(pos - piece.offset);
+        }
+      }
+      std::sort(piece_starts.begin(), piece_starts.end());
+      if (r == 0) {
+        std::swap(starts, piece_starts);
+      } else {
+        joined.clear();
+        std::set_intersection(starts.begin(), starts.end(), piece_starts.begin(), piece_starts.end(),
+            std::back_inserter(joined));
+        std::swap(starts, joined);
+      }
+      if (starts.empty()) {
+        break;
+      }
+    }
+    if (pp.sequences.size() > 1 && !pieces.empty()) {
+      // les jokers des plages entre les morceaux ne doivent pas couvrir un séparateur
+      starts.erase(std::remove_if(starts.begin(), starts.end(), [&](std::size_t p) {
+        return !pp.sequences.within_sequence(p, x.length());
+      }), starts.end());
+    }
+    result.count = starts.size();
+    if (by_document) {
+      count_documents(pp, starts, result.documents);
+      std::vector<std::size_t>().swap(starts);
+    }
+
+    std::chrono::duration<double> time_span = std::chrono::high_resolution_clock::now() - t1;
+    result.search_time = time_span.count();
+  });
+  return results;
+}
+
+#endif /* SRC_DEGENERATE_SEARCH_SPLIT_SEARCH_HPP_ */
@@ -20,28 +20,108 @@
 #include <fstream>
 #include <vector>
 #include <chrono>
+#include <random>
+#include <cstdio>
 
 #include <boost/program_options.hpp>
 
 #include "datatools.h"
 #include "multiletter/acgt_multiletter.h"
 #include "degenerate_search/degenerate_search.hpp"
+#include "degenerate_search/batch_search.hpp"
+#include "degenerate_search/bidirectional_search.hpp"
+#include "degenerate_search/split_search.hpp"
 
 void build_acgt_multiletters(std::vector<ml::acgt_multi_letter> &letters);
+bool valid_frontier(const std::string &frontier);
 
+int index_main(int argc, char **argv);
+int append_main(int argc, char **argv);
+int search_main(int argc, char **argv);
+int rank_bench_main(int argc, char **argv);
+
+template<class occ_type>
+void write_index(const buffer::buffer<unsigned char> &tbuf, const std::vector<ml::acgt_multi_letter> &letters,
+    std::size_t sa_sample_rate, std::size_t kmer_length, bool bidirectional, bool with_text, bool with_documents,
+    unsigned int num_threads, std::size_t max_memory, const std::string &index_file,
+    const std::vector<std::string> &names);
+
+template<class occ_type>
+std::size_t append_to_index(const std::string &index_file, const buffer::buffer<unsigned char> &tbuf,
+    const std::vector<std::string> &names, unsigned int num_threads, std::size_t max_memory,
+    const std::string &output_file);
+
+/**
+ * Options communes aux recherches
+ */
+struct search_options {
+  bool print_positions;
+  bool count_only; // seul le nombre d'occurrences est calculé, sans table des suffixes
+  unsigned int num_threads; // threads de recherche, 0 pour un par cœur
+  std::string frontier; // structure des ensembles d'intervalles : "vector", "tree", "list" ou "adaptive"
+  bool bidirectional; // recherche bidirectionnelle (voir bidirectional_batch_search)
+  std::size_t split_gap; // longueur minimale des plages de jokers où couper les motifs, 0 pour ne pas les couper
+  std::size_t frontier_cap; // taille des ensembles d'intervalles au-delà de laquelle on vérifie sur le texte, 0 pour jamais
+  bool documents; // nombre d'occurrences par séquence, sans localiser les occurrences (voir idx::document_array)
+};
+
+template<typename preproc_type>
+void search_and_report(const preproc_type &pp, const std::vector<buffer::buffer<unsigned char> > &patterns,
+    const std::vector<ml::acgt_multi_letter> &letters, const search_options &options,
+    std::chrono::high_resolution_clock::time_point t1, std::chrono::high_resolution_clock::time_point ts);
+
+template<typename index_type, typename preproc_type>
+void search_and_report(const preproc_type &pp, const std::vector<buffer::buffer<unsigned char> > &patterns,
+    const std::vector<ml::acgt_multi_letter> &letters, const search_options &options,
+    std::chrono::high_resolution_clock::time_point t1, std::chrono::high_resolution_clock::time_point ts);
+
+/**
+ * Usage :
+ *   dsbwt index -i <text> -o <index>      construit l'index et l'écrit sur disque
+ *   dsbwt index append -x <index> -i <text>  ajoute un texte à un index existant
+ *   dsbwt search -x <index> -p <pattern>  recherche dans un index existant
+ *   dsbwt rank-bench -x <index>           mesure le débit des noyaux de rang sur un index
+ *   dsbwt -i <text> -p <pattern>          construit l'index en mémoire puis recherche
+ */
 int main(int argc, char **argv) {
+  if (argc > 1 && std::string(argv[1]) == "index") {
+    return index_main(argc - 1, argv + 1);
+  }
+  if (argc > 1 && std::string(argv[1]) == "search") {
+    return search_main(argc - 1, argv + 1);
+  }
+  if (argc > 1 && std::string(argv[1]) == "rank-bench") {
+    return rank_bench_main(argc - 1, argv + 1);
+  }
+
   std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
 
   namespace po = boost::program_options;
 
   std::string pattern_file;
   std::string text_file;
+  std::size_t sa_sample_rate;
+  std::size_t kmer_length;
+  unsigned int num_threads;
+  std::string frontier;
+  std::size_t split_gap;
+  std::size_t frontier_cap;
 
   po::options_description desc("Allowed options");
   desc.add_options()
       ("help,h", "produce help message")
       ("pattern-file,p", po::value<std::string>(&pattern_file), "path of the pattern file")
-      ("input-file,i", po::value<std::string>(&text_file), "path of the text file");
+      ("input-file,i", po::value<std::string>(&text_file), "path of the text file")
+      ("sa-sample,s", po::value<std::size_t>(&sa_sample_rate)->default_value(32), "suffix array sampling rate (1 keeps the whole suffix array)")
+      ("kmer-length,k", po::value<std::size_t>(&kmer_length)->default_value(0), "length of the words of the k-mer interval table (0: no table)")
+      ("positions", "print the positions of the occurrences of each pattern")
+      ("count", "only count the occurrences, without building the suffix array")
+      ("documents", "print the number of occurrences in each sequence, without locating the occurrences")
+      ("bidirectional", "also index the reversed text and start each search from the most selective block of the pattern")
+      ("split", po::value<std::size_t>(&split_gap)->default_value(0), "cut the patterns at runs of at least this many fully degenerate letters and join the located pieces (0: no cut)")
+      ("frontier-cap", po::value<std::size_t>(&frontier_cap)->default_value(0), "number of intervals past which the occurrences are located and the rest of the patterns is checked against the text (0: never)")
+      ("threads,t", po::value<unsigned int>(&num_threads)->default_value(1), "number of threads building the index and searching (0 uses every core)")
+      ("frontier", po::value<std::string>(&frontier)->default_value("vector"), "set of intervals used by the search: vector, tree, list or adaptive");
 
 
   po::variables_map vm;
@@ -49,11 +129,15 @@ int main(int argc, char **argv) {
   po::notify(vm);
 
   if (vm.count("help")) {
+    std::cout << "Usage: dsbwt [index|search|rank-bench] <options>" << std::endl;
     std::cout << desc << std::endl;
     return EXIT_SUCCESS;
   }
 
-  if (!vm.count("pattern-file") || !vm.count("input-file")) {
+  if (!vm.count("pattern-file") || !vm.count("input-file") || sa_sample_rate == 0 || !valid_frontier(frontier)
+      || (vm.count("count") && (vm.count("positions") || split_gap > 0 || frontier_cap > 0))
+      || (vm.count("documents") && (vm.count("count") || vm.count("positions")))
+      || kmer_length > idx::kmer_table::max_kmer_length) {
     std::cerr << desc << std::endl;
     return EXIT_FAILURE;
   }
@@ -68,8 +152,9 @@ int main(int argc, char **argv) {
     throw std::runtime_error("unable to open text file");
   }
 
-  buffer::buffer<unsigned char> pbuf = read_pattern(pf);
-  buffer::buffer<unsigned char> tbuf = read_text(tf);
+  std::vector<buffer::buffer<unsigned char> > patterns = read_patterns(pf);
+  std::vector<std::string> names;
+  buffer::buffer<unsigned char> tbuf = read_sequences(tf, names);
 
   pf.close();
   tf.close();
@@ -77,30 +162,488 @@ int main(int argc, char **argv) {
   std::vector<ml::acgt_multi_letter> letters(16);
   build_acgt_multiletters(letters);
 
+  search_options options;
+  options.print_positions = vm.count("positions") > 0;
+  options.count_only = vm.count("count") > 0;
+  options.num_threads = num_threads;
+  options.frontier = frontier;
+  options.bidirectional = vm.count("bidirectional") > 0;
+  options.split_gap = split_gap;
+  options.frontier_cap = frontier_cap;
+  options.documents = vm.count("documents") > 0;
+  if (options.count_only) {
+    sa_sample_rate = 0; // pas de table des suffixes
+  }
+
+  unsigned int build_threads = num_threads == 0 ? std::max(1u, std::thread::hardware_concurrency()) : num_threads;
+
   std::chrono::high_resolution_clock::time_point ts = std::chrono::high_resolution_clock::now();
-  preproc_backward_search2<unsigned char, ml::acgt_multi_letter> pp(tbuf, letters);
-  ranges::range_tree r2 = degenerate_backward_search_in_bwt2(pbuf, letters, pp.bwt, pp.rs, letters);
-  std::chrono::duration<double> time_search = std::chrono::high_resolution_clock::now() - ts;
-
-  std::vector<std::size_t> v;
-  for (auto r : r2) {
-    for (int p = r.get_low(); p <= r.get_high(); ++p) {
-      v.push_back(pp.SA[p]);
+  if (idx::dna_occ::is_dna(tbuf)) {
+    preproc_backward_search2<unsigned char, ml::acgt_multi_letter, idx::dna_occ> pp(tbuf, letters, sa_sample_rate, kmer_length,
+        options.bidirectional, options.frontier_cap > 0, build_threads, 0, std::string(), names);
+    if (options.documents) {
+      pp.build_documents();
+    }
+    search_and_report(pp, patterns, letters, options, t1, ts);
+  } else {
+    preproc_backward_search2<unsigned char, ml::acgt_multi_letter> pp(tbuf, letters, sa_sample_rate, kmer_length,
+        options.bidirectional, options.frontier_cap > 0, build_threads, 0, std::string(), names);
+    if (options.documents) {
+      pp.build_documents();
     }
+    search_and_report(pp, patterns, letters, options, t1, ts);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+int index_main(int argc, char **argv) {
+  if (argc > 1 && std::string(argv[1]) == "append") {
+    return append_main(argc - 1, argv + 1);
+  }
+
+  std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+
+  namespace po = boost::program_options;
+
+  std::string text_file;
+  std::string index_file;
+  std::size_t sa_sample_rate;
+  std::size_t kmer_length;
+  unsigned int num_threads;
+  std::size_t max_memory;
+
+  po::options_description desc("Allowed options");
+  desc.add_options()
+      ("help,h", "produce help message")
+      ("input-file,i", po::value<std::string>(&text_file), "path of the text file")
+      ("index-file,o", po::value<std::string>(&index_file), "path of the index file to write")
+      ("sa-sample,s", po::value<std::size_t>(&sa_sample_rate)->default_value(32), "suffix array sampling rate (1 keeps the whole suffix array)")
+      ("kmer-length,k", po::value<std::size_t>(&kmer_length)->default_value(0), "length of the words of the k-mer interval table (0: no table)")
+      ("bidirectional", "also index the reversed text, for bidirectional search")
+      ("packed-text", "also store the text on 2 bits per letter, for --frontier-cap")
+      ("documents", "also store the sequence of each suffix, for --documents")
+      ("threads,t", po::value<unsigned int>(&num_threads)->default_value(1), "number of threads building the index (0 uses every core)")
+      ("max-memory", po::value<std::size_t>(&max_memory)->default_value(0), "build the BWT by blocks on disk, next to the index file, with this many megabytes of working memory (0: in memory)");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << "Usage: dsbwt index <options>" << std::endl;
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (!vm.count("input-file") || !vm.count("index-file") || sa_sample_rate == 0
+      || kmer_length > idx::kmer_table::max_kmer_length) {
+    std::cerr << desc << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream tf(text_file);
+  if (!tf.is_open()) {
+    throw std::runtime_error("unable to open text file");
+  }
+  std::vector<std::string> names;
+  buffer::buffer<unsigned char> tbuf = read_sequences(tf, names);
+  tf.close();
+
+  std::vector<ml::acgt_multi_letter> letters(16);
+  build_acgt_multiletters(letters);
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  if (idx::dna_occ::is_dna(tbuf)) {
+    write_index<idx::dna_occ>(tbuf, letters, sa_sample_rate, kmer_length, vm.count("bidirectional") > 0,
+        vm.count("packed-text") > 0, vm.count("documents") > 0, num_threads, max_memory << 20, index_file, names);
+  } else {
+    write_index<idx::compact_rank>(tbuf, letters, sa_sample_rate, kmer_length, vm.count("bidirectional") > 0,
+        vm.count("packed-text") > 0, vm.count("documents") > 0, num_threads, max_memory << 20, index_file, names);
   }
-  
+
   std::chrono::duration<double> time_span = std::chrono::high_resolution_clock::now() - t1;
+  std::cout << "Number of sequences: " << names.size() << std::endl;
+  std::cout << "Text length: " << tbuf.length() - 1 << std::endl;
+  std::cout << "Total elapse time: " << time_span.count() << " sec" << std::endl;
 
-  std::cout << "Number of results: " << v.size() << std::endl;
-  std::cout << "Search time: " << time_search.count() << " sec" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Ajoute le texte d'un fichier à un index existant sans le reconstruire
+ * (voir preproc_backward_search2::append) et écrit le nouvel index, par défaut à la place
+ * de l'ancien
+ */
+int append_main(int argc, char **argv) {
+  std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+
+  namespace po = boost::program_options;
+
+  std::string text_file;
+  std::string index_file;
+  std::string output_file;
+  unsigned int num_threads;
+  std::size_t max_memory;
+
+  po::options_description desc("Allowed options");
+  desc.add_options()
+      ("help,h", "produce help message")
+      ("input-file,i", po::value<std::string>(&text_file), "path of the text file to append")
+      ("index-file,x", po::value<std::string>(&index_file), "path of the index file")
+      ("output-file,o", po::value<std::string>(&output_file), "path of the new index file (default: replace the index file)")
+      ("threads,t", po::value<unsigned int>(&num_threads)->default_value(1), "number of threads rebuilding the index structures (0 uses every core)")
+      ("max-memory", po::value<std::size_t>(&max_memory)->default_value(0), "insert the text by blocks using this many megabytes of working memory (0: in one block)");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << "Usage: dsbwt index append <options>" << std::endl;
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (!vm.count("input-file") || !vm.count("index-file")) {
+    std::cerr << desc << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!vm.count("output-file")) {
+    output_file = index_file;
+  }
+
+  std::ifstream tf(text_file);
+  if (!tf.is_open()) {
+    throw std::runtime_error("unable to open text file");
+  }
+  std::vector<std::string> names;
+  buffer::buffer<unsigned char> tbuf = read_sequences(tf, names);
+  tf.close();
+
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  std::size_t length;
+  if (idx::read_occ_kind(index_file) == idx::dna_occ::kind) {
+    if (!idx::dna_occ::is_dna(tbuf)) {
+      throw std::runtime_error("the index of a text over ACGT cannot be appended a text with degenerate letters");
+    }
+    length = append_to_index<idx::dna_occ>(index_file, tbuf, names, num_threads, max_memory << 20, output_file);
+  } else {
+    length = append_to_index<idx::compact_rank>(index_file, tbuf, names, num_threads, max_memory << 20, output_file);
+  }
+
+  std::chrono::duration<double> time_span = std::chrono::high_resolution_clock::now() - t1;
+  std::cout << "Appended sequences: " << names.size() << std::endl;
+  std::cout << "Appended length: " << tbuf.length() - 1 << std::endl;
+  std::cout << "Text length: " << length - 1 << std::endl;
   std::cout << "Total elapse time: " << time_span.count() << " sec" << std::endl;
 
   return EXIT_SUCCESS;
 }
 
+int search_main(int argc, char **argv) {
+  std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+
+  namespace po = boost::program_options;
+
+  std::string pattern_file;
+  std::string index_file;
+  unsigned int num_threads;
+  std::string frontier;
+  std::size_t split_gap;
+  std::size_t frontier_cap;
+
+  po::options_description desc("Allowed options");
+  desc.add_options()
+      ("help,h", "produce help message")
+      ("pattern-file,p", po::value<std::string>(&pattern_file), "path of the pattern file")
+      ("index-file,x", po::value<std::string>(&index_file), "path of the index file")
+      ("positions", "print the positions of the occurrences of each pattern")
+      ("count", "only count the occurrences, without loading the suffix array")
+      ("documents", "print the number of occurrences in each sequence, without locating the occurrences (index built with --documents)")
+      ("bidirectional", "start each search from the most selective block of the pattern (index built with --bidirectional)")
+      ("split", po::value<std::size_t>(&split_gap)->default_value(0), "cut the patterns at runs of at least this many fully degenerate letters and join the located pieces (0: no cut)")
+      ("frontier-cap", po::value<std::size_t>(&frontier_cap)->default_value(0), "number of intervals past which the occurrences are located and the rest of the patterns is checked against the text (0: never)")
+      ("threads,t", po::value<unsigned int>(&num_threads)->default_value(1), "number of search threads (0 uses every core)")
+      ("frontier", po::value<std::string>(&frontier)->default_value("vector"), "set of intervals used by the search: vector, tree, list or adaptive");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << "Usage: dsbwt search <options>" << std::endl;
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (!vm.count("pattern-file") || !vm.count("index-file") || !valid_frontier(frontier)
+      || (vm.count("count") && (vm.count("positions") || split_gap > 0 || frontier_cap > 0))
+      || (vm.count("documents") && (vm.count("count") || vm.count("positions")))) {
+    std::cerr << desc << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  std::ifstream pf(pattern_file);
+  if (!pf.is_open()) {
+    throw std::runtime_error("unable to open pattern file");
+  }
+  std::vector<buffer::buffer<unsigned char> > patterns = read_patterns(pf);
+  pf.close();
+
+  std::vector<ml::acgt_multi_letter> letters(16);
+  build_acgt_multiletters(letters);
+
+  search_options options;
+  options.print_positions = vm.count("positions") > 0;
+  options.count_only = vm.count("count") > 0;
+  options.num_threads = num_threads;
+  options.frontier = frontier;
+  options.bidirectional = vm.count("bidirectional") > 0;
+  options.split_gap = split_gap;
+  options.frontier_cap = frontier_cap;
+  options.documents = vm.count("documents") > 0;
+
+  std::chrono::high_resolution_clock::time_point ts = std::chrono::high_resolution_clock::now();
+  if (idx::read_occ_kind(index_file) == idx::dna_occ::kind) {
+    preproc_backward_search2<unsigned char, ml::acgt_multi_letter, idx::dna_occ> pp(index_file, !options.count_only);
+    search_and_report(pp, patterns, letters, options, t1, ts);
+  } else {
+    preproc_backward_search2<unsigned char, ml::acgt_multi_letter> pp(index_file, !options.count_only);
+    search_and_report(pp, patterns, letters, options, t1, ts);
+  }
+
+  return EXIT_SUCCESS;
+}
+
+/**
+ * Mesure le nombre de rangs calculés par seconde par chacun des noyaux de idx::rank_kernels
+ * sur la table des occurrences d'un index sur ACGT, pour les mêmes positions tirées au hasard.
+ * Les rangs sont demandés par paquets, comme dans la recherche arrière.
+ */
+int rank_bench_main(int argc, char **argv) {
+  namespace po = boost::program_options;
+
+  std::string index_file;
+  std::size_t num_queries;
+
+  po::options_description desc("Allowed options");
+  desc.add_options()
+      ("help,h", "produce help message")
+      ("index-file,x", po::value<std::string>(&index_file), "path of the index file")
+      ("queries,n", po::value<std::size_t>(&num_queries)->default_value(10000000), "number of rank positions per letter");
+
+  po::variables_map vm;
+  po::store(po::parse_command_line(argc, argv, desc), vm);
+  po::notify(vm);
+
+  if (vm.count("help")) {
+    std::cout << "Usage: dsbwt rank-bench <options>" << std::endl;
+    std::cout << desc << std::endl;
+    return EXIT_SUCCESS;
+  }
+
+  if (!vm.count("index-file") || num_queries == 0) {
+    std::cerr << desc << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  if (idx::read_occ_kind(index_file) != idx::dna_occ::kind) {
+    throw std::runtime_error("rank-bench needs the index of a text over ACGT");
+  }
+  preproc_backward_search2<unsigned char, ml::acgt_multi_letter, idx::dna_occ> pp(index_file);
+
+  std::mt19937_64 generator(1);
+  std::uniform_int_distribution<std::size_t> distribution(0, pp.size());
+  std::vector<std::size_t> positions(num_queries);
+  for (std::size_t &p : positions) {
+    p = distribution(generator);
+  }
+  std::vector<std::size_t> ranks(num_queries);
+  const std::size_t batch = 2 * rank_batch_size;
+  const std::size_t acgt[4] = { 1, 2, 4, 8 };
+
+  std::cout << "Text length: " << pp.size() - 1 << std::endl;
+
+  // référence : une requête rank(c, i) par position
+  std::size_t expected = 0;
+  std::chrono::high_resolution_clock::time_point t1 = std::chrono::high_resolution_clock::now();
+  for (std::size_t c : acgt) {
+    for (std::size_t p : positions) {
+      expected += pp.occ.rank(c, p);
+    }
+  }
+  std::chrono::duration<double> time_span = std::chrono::high_resolution_clock::now() - t1;
+  std::cout << "rank: " << 4 * num_queries / time_span.count() << " ranks/sec" << std::endl;
+
+  for (const idx::rank_kernel &kernel : idx::rank_kernels()) {
+    if (!kernel.supported()) {
+      std::cout << kernel.name << ": not supported by this processor" << std::endl;
+      continue;
+    }
+    std::size_t sum = 0;
+    t1 = std::chrono::high_resolution_clock::now();
+    for (std::size_t c : acgt) {
+      for (std::size_t j = 0; j < num_queries; j += batch) {
+        pp.occ.rank_batch(c, positions.data() + j, std::min(batch, num_queries - j), ranks.data() + j, kernel);
+      }
+      for (std::size_t r : ranks) {
+        sum += r;
+      }
+    }
+    time_span = std::chrono::high_resolution_clock::now() - t1;
+    if (sum != expected) {
+      throw std::runtime_error(std::string("rank kernel ") + kernel.name + " computed wrong ranks");
+    }
+    std::cout << kernel.name << ": " << 4 * num_queries / time_span.count() << " ranks/sec"
+        << (&kernel == &idx::best_rank_kernel() ? " (used by search)" : "") << std::endl;
+  }
+
+  return EXIT_SUCCESS;
+}
+
+template<class occ_type>
+void write_index(const buffer::buffer<unsigned char> &tbuf, const std::vector<ml::acgt_multi_letter> &letters,
+    std::size_t sa_sample_rate, std::size_t kmer_length, bool bidirectional, bool with_text, bool with_documents,
+    unsigned int num_threads, std::size_t max_memory, const std::string &index_file,
+    const std::vector<std::string> &names) {
+  // les fichiers temporaires de la construction sur disque sont à côté de l'index
+  preproc_backward_search2<unsigned char, ml::acgt_multi_letter, occ_type> pp(tbuf, letters, sa_sample_rate, kmer_length,
+      bidirectional, with_text, num_threads, max_memory, index_file + ".tmp", names);
+  if (with_documents) {
+    pp.build_documents();
+  }
+
+  std::ofstream out(index_file, std::ios::binary);
+  if (!out.is_open()) {
+    throw std::runtime_error("unable to open index file");
+  }
+  pp.serialize(out);
+  out.close();
+  if (!out) {
+    throw std::runtime_error("unable to write index file");
+  }
+}
+
+/**
+ * Le nouvel index est d'abord écrit dans un fichier temporaire, renommé ensuite en output_file :
+ * l'ancien index reste intact si l'ajout échoue. Retourne la longueur de la BWT du nouvel index.
+ */
+template<class occ_type>
+std::size_t append_to_index(const std::string &index_file, const buffer::buffer<unsigned char> &tbuf,
+    const std::vector<std::string> &names, unsigned int num_threads, std::size_t max_memory,
+    const std::string &output_file) {
+  preproc_backward_search2<unsigned char, ml::acgt_multi_letter, occ_type> pp(index_file);
+  pp.append(tbuf, num_threads, max_memory, output_file + ".tmp", names);
+
+  const std::string new_file = output_file + ".new";
+  std::ofstream out(new_file, std::ios::binary);
+  if (!out.is_open()) {
+    throw std::runtime_error("unable to open index file");
+  }
+  pp.serialize(out);
+  out.close();
+  if (!out || std::rename(new_file.c_str(), output_file.c_str()) != 0) {
+    std::remove(new_file.c_str());
+    throw std::runtime_error("unable to write index file");
+  }
+  return pp.size();
+}
+
+/**
+ * Choisit le type des bornes des intervalles en fonction de la longueur du texte :
+ * 32 bits tant que possible, 64 bits au-delà
+ */
+template<typename preproc_type>
+void search_and_report(const preproc_type &pp, const std::vector<buffer::buffer<unsigned char> > &patterns,
+    const std::vector<ml::acgt_multi_letter> &letters, const search_options &options,
+    std::chrono::high_resolution_clock::time_point t1, std::chrono::high_resolution_clock::time_point ts) {
+  if (fits_index_type<std::int32_t>(pp.size())) {
+    search_and_report<std::int32_t>(pp, patterns, letters, options, t1, ts);
+  } else {
+    search_and_report<std::int64_t>(pp, patterns, letters, options, t1, ts);
+  }
+}
+
+template<typename index_type, typename preproc_type>
+void search_and_report(const preproc_type &pp, const std::vector<buffer::buffer<unsigned char> > &patterns,
+    const std::vector<ml::acgt_multi_letter> &letters, const search_options &options,
+    std::chrono::high_resolution_clock::time_point t1, std::chrono::high_resolution_clock::time_point ts) {
+  std::chrono::duration<double> time_index = std::chrono::high_resolution_clock::now() - ts;
+
+  unsigned int num_threads = options.num_threads;
+  if (num_threads == 0) {
+    num_threads = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  std::chrono::high_resolution_clock::time_point tb = std::chrono::high_resolution_clock::now();
+  std::vector<pattern_result> results;
+  if (options.split_gap > 0) {
+    results = split_batch_search<index_type>(pp, patterns, letters, options.split_gap, num_threads,
+        options.bidirectional, options.documents);
+  } else if (options.bidirectional) {
+    results = bidirectional_batch_search<index_type>(pp, patterns, letters, num_threads, options.count_only,
+        options.documents);
+  } else if (options.frontier == "tree") {
+    results = batch_search<index_type, ranges::basic_range_tree<index_type> >(pp, patterns, letters, num_threads,
+        options.count_only, options.frontier_cap, options.documents);
+  } else if (options.frontier == "adaptive") {
+    results = batch_search<index_type, ranges::basic_adaptive_frontier<index_type> >(pp, patterns, letters,
+        num_threads, options.count_only, options.frontier_cap, options.documents);
+  } else if (options.frontier == "list") {
+    results = batch_search<index_type, std::list<ranges::basic_range<index_type> > >(pp, patterns, letters, num_threads,
+        options.count_only, options.frontier_cap, options.documents);
+  } else {
+    results = batch_search<index_type, ranges::basic_range_vector<index_type> >(pp, patterns, letters, num_threads,
+        options.count_only, options.frontier_cap, options.documents);
+  }
+  std::chrono::duration<double> time_search = std::chrono::high_resolution_clock::now() - tb;
+
+  std::uint64_t num_results = 0;
+  for (std::size_t j = 0; j < results.size(); ++j) {
+    std::cout << "Pattern " << j + 1 << ": " << results[j].count << " results in "
+        << results[j].search_time << " sec" << std::endl;
+    if (options.print_positions) {
+      // position dans sa séquence, précédée du nom de la séquence
+      std::cout << "Positions:";
+      for (std::size_t p : results[j].positions) {
+        std::size_t k = pp.sequences.sequence_at(p);
+        std::cout << " " << pp.sequences.name(k) << ":" << p - pp.sequences.start(k);
+      }
+      std::cout << std::endl;
+    }
+    if (options.documents) {
+      // nombre d'occurrences de chaque séquence où le motif apparaît
+      std::cout << "Sequences:";
+      for (const auto &d : results[j].documents) {
+        std::cout << " " << pp.sequences.name(d.first) << ":" << d.second;
+      }
+      std::cout << std::endl;
+    }
+    num_results += results[j].count;
+  }
+
+  std::chrono::duration<double> time_span = std::chrono::high_resolution_clock::now() - t1;
+
+  std::cout << "Number of patterns: " << patterns.size() << std::endl;
+  std::cout << "Number of results: " << num_results << std::endl;
+  std::cout << "Index time: " << time_index.count() << " sec" << std::endl;
+  std::cout << "Search time: " << time_search.count() << " sec" << std::endl;
+  std::cout << "Total elapse time: " << time_span.count() << " sec" << std::endl;
+}
+
 void build_acgt_multiletters(std::vector<ml::acgt_multi_letter> &letters) {
   for (int i = 0; i < 16; ++i) {
     letters[i] = ml::acgt_multi_letter(i);
   }
 }
 
+bool valid_frontier(const std::string &frontier) {
+  return frontier == "vector" || frontier == "tree" || frontier == "list" || frontier == "adaptive";
+}
@@ -0,0 +1,174 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "index/compact_rank.h"
+#include "index/index_format.h"
+#include "index/parallel.h"
+
+#include <algorithm>
+#include <utility>
+
+namespace idx {
+
+const std::uint64_t compact_rank::kind;
+
+compact_rank::compact_rank() : n(0), bv(nullptr), rs(nullptr) {
+}
+
+compact_rank::compact_rank(const buffer::buffer<unsigned char> &bwt, std::size_t alpha_size, unsigned int num_threads)
+    : n(bwt.length()), slot(alpha_size, -1), bv(nullptr), rs(nullptr) {
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  // les tranches de lignes sont alignées sur les mots de 64 bits des bit_vector,
+  // que les threads remplissent sans se partager de mot
+  std::vector<std::vector<char> > seen(num_threads, std::vector<char>(alpha_size, 0));
+  std::vector<std::vector<std::uint64_t> > chunk_zero_rows(num_threads);
+  parallel_chunks(n, 64, num_threads, [&](unsigned int t, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      if (bwt[i] == 0) {
+        chunk_zero_rows[t].push_back(i);
+      } else {
+        seen[t][bwt[i]] = 1;
+      }
+    }
+  });
+
+  std::vector<bool> present(alpha_size, false);
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    zero_rows.insert(zero_rows.end(), chunk_zero_rows[t].begin(), chunk_zero_rows[t].end());
+    for (std::size_t c = 0; c < alpha_size; ++c) {
+      if (seen[t][c]) {
+        present[c] = true;
+      }
+    }
+  }
+  for (std::size_t c = 1; c < alpha_size; ++c) {
+    if (present[c]) {
+      slot[c] = letters.size();
+      letters.push_back(c);
+    }
+  }
+
+  bv = new sdsl::bit_vector[letters.size()];
+  for (std::size_t s = 0; s < letters.size(); ++s) {
+    bv[s] = sdsl::bit_vector(n, 0);
+  }
+  parallel_chunks(n, 64, num_threads, [&](unsigned int, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      if (bwt[i] != 0) {
+        bv[slot[bwt[i]]][i] = 1;
+      }
+    }
+  });
+
+  // une structure de rang par lettre, construites en même temps
+  rs = new sdsl::rank_support_v<>[letters.size()];
+  parallel_tasks(letters.size(), num_threads, [&](std::size_t s) {
+    sdsl::util::assign(rs[s], sdsl::rank_support_v<>(&(bv[s])));
+  });
+}
+
+compact_rank::compact_rank(compact_rank &&r) : n(0), bv(nullptr), rs(nullptr) {
+  *this = std::move(r);
+}
+
+compact_rank::~compact_rank() {
+  delete[] rs;
+  delete[] bv;
+}
+
+compact_rank& compact_rank::operator=(compact_rank &&r) {
+  // Les rank_support_v pointent sur les bit_vector : on échange les tableaux
+  // sans déplacer leurs éléments
+  std::swap(n, r.n);
+  std::swap(slot, r.slot);
+  std::swap(letters, r.letters);
+  std::swap(bv, r.bv);
+  std::swap(rs, r.rs);
+  std::swap(zero_rows, r.zero_rows);
+  return *this;
+}
+
+void compact_rank::rank_all(std::size_t i, std::size_t *counts) const {
+  std::fill(counts, counts + slot.size(), 0);
+  for (std::size_t s = 0; s < letters.size(); ++s) {
+    counts[letters[s]] = rs[s](i);
+  }
+  counts[0] = rank_zero(i);
+}
+
+unsigned char compact_rank::access(std::size_t i) const {
+  for (std::size_t s = 0; s < letters.size(); ++s) {
+    if (bv[s][i]) {
+      return letters[s];
+    }
+  }
+  return 0;
+}
+
+std::size_t compact_rank::rank_zero(std::size_t i) const {
+  return std::lower_bound(zero_rows.begin(), zero_rows.end(), i) - zero_rows.begin();
+}
+
+std::uint64_t compact_rank::zero_mask(std::size_t w) const {
+  std::uint64_t mask = 0;
+  for (auto it = std::lower_bound(zero_rows.begin(), zero_rows.end(), 64 * w);
+      it != zero_rows.end() && *it < 64 * (w + 1); ++it) {
+    mask |= 1ULL << (*it % 64);
+  }
+  return mask;
+}
+
+void compact_rank::serialize(std::ostream &out) const {
+  write_value<std::uint64_t>(out, n);
+  write_value<std::uint64_t>(out, slot.size());
+  write_value<std::uint64_t>(out, letters.size());
+  write_array(out, letters.data(), letters.size());
+  write_value<std::uint64_t>(out, zero_rows.size());
+  write_array(out, zero_rows.data(), zero_rows.size());
+  for (std::size_t s = 0; s < letters.size(); ++s) {
+    bv[s].serialize(out);
+    rs[s].serialize(out);
+  }
+}
+
+void compact_rank::load(std::istream &in) {
+  delete[] rs;
+  delete[] bv;
+
+  n = read_value<std::uint64_t>(in);
+  slot.assign(read_value<std::uint64_t>(in), -1);
+  letters.resize(read_value<std::uint64_t>(in));
+  read_array(in, letters.data(), letters.size());
+  zero_rows.resize(read_value<std::uint64_t>(in));
+  read_array(in, zero_rows.data(), zero_rows.size());
+
+  bv = new sdsl::bit_vector[letters.size()];
+  rs = new sdsl::rank_support_v<>[letters.size()];
+  for (std::size_t s = 0; s < letters.size(); ++s) {
+    if (letters[s] >= slot.size()) {
+      throw std::runtime_error("invalid index file");
+    }
+    slot[letters[s]] = s;
+    bv[s].load(in);
+    rs[s].load(in, &(bv[s]));
+  }
+}
+
+}
@@ -0,0 +1,150 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_COMPACT_RANK_H_
+#define INDEX_COMPACT_RANK_H_
+
+#include "buffer/buffer.h"
+#include "index/mapped_file.h"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+#include <sdsl/vectors.hpp>
+
+namespace idx {
+
+/**
+ * Structure de rang sur la BWT qui ne matérialise un vecteur de bits
+ * (et son rank_support_v) que pour les lettres présentes dans la BWT.
+ * Le 0 de fin de texte, qui n'apparaît qu'une fois, est conservé à part
+ * sous la forme de la liste triée des lignes où il apparaît.
+ * Pour un texte solide sur ACGT on a ainsi 4 vecteurs au lieu de 16.
+ */
+class compact_rank {
+public:
+  static const std::uint64_t kind = 0;
+
+  compact_rank();
+  /**
+   * Construit la structure de bwt avec num_threads threads : les vecteurs de bits sont
+   * remplis par tranches de lignes et les rank_support_v construits en parallèle
+   */
+  compact_rank(const buffer::buffer<unsigned char> &bwt, std::size_t alpha_size, unsigned int num_threads = 1);
+  compact_rank(compact_rank &&r);
+  ~compact_rank();
+
+  compact_rank& operator=(compact_rank &&r);
+
+  /**
+   * Nombre d'occurrences de la lettre c dans bwt[0 .. i - 1]
+   */
+  std::size_t rank(std::size_t c, std::size_t i) const {
+    if (c == 0) {
+      return rank_zero(i);
+    }
+    int s = slot[c];
+    return s < 0 ? 0 : rs[s](i);
+  }
+
+  /**
+   * counts[c] = rank(c, i) pour 0 <= c < get_alpha_size()
+   */
+  void rank_all(std::size_t i, std::size_t *counts) const;
+
+  /**
+   * ranks[k] = rank(c, positions[k]) pour 0 <= k < count
+   */
+  void rank_batch(std::size_t c, const std::size_t *positions, std::size_t count, std::size_t *ranks) const {
+    for (std::size_t k = 0; k < count; ++k) {
+      ranks[k] = rank(c, positions[k]);
+    }
+  }
+
+  /**
+   * Demande le chargement en cache des mots des vecteurs de bits lus par rank(c, i)
+   */
+  void prefetch(std::size_t i) const {
+    for (std::size_t s = 0; s < letters.size(); ++s) {
+      __builtin_prefetch(bv[s].data() + i / 64);
+    }
+  }
+
+  /**
+   * Masque des lignes 64 * w .. 64 * w + 63 qui portent la lettre c : le bit k vaut 1
+   * ssi bwt[64 * w + k] = c (voir ranges::basic_adaptive_frontier)
+   */
+  std::uint64_t letter_mask(std::size_t c, std::size_t w) const {
+    if (c == 0) {
+      return zero_mask(w);
+    }
+    int s = slot[c];
+    return s < 0 ? 0 : bv[s].data()[w];
+  }
+
+  /**
+   * Retourne bwt[i]
+   */
+  unsigned char access(std::size_t i) const;
+
+  /**
+   * Vrai si la lettre c apparaît dans la BWT
+   */
+  bool contains(std::size_t c) const {
+    return c == 0 ? !zero_rows.empty() : slot[c] >= 0;
+  }
+
+  std::size_t size() const {
+    return n;
+  }
+
+  std::size_t get_alpha_size() const {
+    return slot.size();
+  }
+
+  void serialize(std::ostream &out) const;
+  void load(std::istream &in);
+
+  /**
+   * Les vecteurs de sdsl ne peuvent pas être utilisés en place : ils sont recopiés
+   * depuis le fichier projeté
+   */
+  void load(mapped_reader &in) {
+    load(in.stream());
+  }
+
+private:
+  compact_rank(const compact_rank &r);
+  compact_rank& operator=(const compact_rank &r);
+
+  std::size_t rank_zero(std::size_t i) const;
+  std::uint64_t zero_mask(std::size_t w) const;
+
+  std::size_t n;
+  std::vector<int> slot; // slot[c] : indice de la lettre c dans bv et rs, -1 si c est absente
+  std::vector<unsigned char> letters; // letters[s] : lettre correspondant à bv[s]
+  sdsl::bit_vector *bv;
+  sdsl::rank_support_v<> *rs;
+  std::vector<std::uint64_t> zero_rows;
+};
+
+}
+
+#endif /* INDEX_COMPACT_RANK_H_ */
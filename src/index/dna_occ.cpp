@@ -0,0 +1,255 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "index/dna_occ.h"
+#include "index/index_format.h"
+#include "index/parallel.h"
+
+#include <algorithm>
+#include <array>
+#include <cstdlib>
+#include <new>
+#include <utility>
+
+namespace idx {
+
+const std::uint64_t dna_occ::kind;
+const std::size_t dna_occ::block_size;
+const int dna_occ::letter_code[16] = { -1, 0, 1, -1, 2, -1, -1, -1, 3, -1, -1, -1, -1, -1, -1, -1 };
+
+dna_occ::dna_occ() : n(0), alpha_size(0), num_blocks(0), blocks(nullptr), owns_blocks(true), kernel(&best_rank_kernel()) {
+}
+
+dna_occ::dna_occ(const buffer::buffer<unsigned char> &bwt, std::size_t alpha_size, unsigned int num_threads)
+    : n(bwt.length()), alpha_size(alpha_size), num_blocks(0), blocks(nullptr), owns_blocks(true), present(alpha_size, false),
+      kernel(&best_rank_kernel()) {
+  assert(alpha_size == 16);
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  // + 1 bloc pour pouvoir calculer rank(c, n)
+  allocate(n / block_size + 1);
+
+  // Chaque thread remplit une tranche de blocs avec des compteurs relatifs au début
+  // de sa tranche, corrigés ensuite par les totaux des tranches précédentes
+  std::vector<std::array<std::uint64_t, 4> > chunk_counts(num_threads); // A, C, G et 0
+  std::vector<std::vector<char> > seen(num_threads, std::vector<char>(alpha_size, 0));
+  std::vector<std::vector<std::uint64_t> > chunk_zero_rows(num_threads);
+  std::vector<char> invalid(num_threads, 0);
+  parallel_chunks(num_blocks, 1, num_threads, [&](unsigned int t, std::size_t first, std::size_t last) {
+    std::array<std::uint64_t, 4> counts = { { 0, 0, 0, 0 } };
+    for (std::size_t k = first; k < last; ++k) {
+      block &b = blocks[k];
+      for (int code = 0; code < 3; ++code) {
+        b.counts[code] = counts[code];
+      }
+      b.zeros = counts[3] << 8;
+      for (int w = 0; w < 4; ++w) {
+        b.bits[w] = 0;
+      }
+      for (std::size_t i = k * block_size; i < std::min(n, (k + 1) * block_size); ++i) {
+        unsigned char c = bwt[i];
+        int code = 0;
+        if (c == 0) {
+          chunk_zero_rows[t].push_back(i);
+          ++counts[3];
+          ++b.zeros;
+        } else {
+          code = c < 16 ? letter_code[c] : -1;
+          if (code < 0) {
+            invalid[t] = 1;
+            code = 0;
+          }
+          if (code < 3) {
+            ++counts[code];
+          }
+        }
+        seen[t][c < alpha_size ? c : 0] = 1;
+        std::size_t o = i % block_size;
+        b.bits[o / 32] |= (std::uint64_t) code << (2 * (o % 32));
+      }
+    }
+    chunk_counts[t] = counts;
+  });
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    if (invalid[t]) {
+      throw std::runtime_error("dna_occ: BWT is not over ACGT");
+    }
+  }
+
+  std::vector<std::array<std::uint64_t, 4> > offsets(num_threads);
+  std::array<std::uint64_t, 4> total = { { 0, 0, 0, 0 } };
+  for (unsigned int t = 0; t < num_threads; ++t) {
+    offsets[t] = total;
+    for (int j = 0; j < 4; ++j) {
+      total[j] += chunk_counts[t][j];
+    }
+    zero_rows.insert(zero_rows.end(), chunk_zero_rows[t].begin(), chunk_zero_rows[t].end());
+    for (std::size_t c = 0; c < alpha_size; ++c) {
+      if (seen[t][c]) {
+        present[c] = true;
+      }
+    }
+  }
+  parallel_chunks(num_blocks, 1, num_threads, [&](unsigned int t, std::size_t first, std::size_t last) {
+    for (std::size_t k = first; k < last; ++k) {
+      for (int code = 0; code < 3; ++code) {
+        blocks[k].counts[code] += offsets[t][code];
+      }
+      blocks[k].zeros += offsets[t][3] << 8;
+    }
+  });
+}
+
+dna_occ::dna_occ(dna_occ &&o) : n(0), alpha_size(0), num_blocks(0), blocks(nullptr), owns_blocks(true), kernel(&best_rank_kernel()) {
+  *this = std::move(o);
+}
+
+dna_occ::~dna_occ() {
+  if (owns_blocks) {
+    free(blocks);
+  }
+}
+
+dna_occ& dna_occ::operator=(dna_occ &&o) {
+  std::swap(n, o.n);
+  std::swap(alpha_size, o.alpha_size);
+  std::swap(num_blocks, o.num_blocks);
+  std::swap(blocks, o.blocks);
+  std::swap(owns_blocks, o.owns_blocks);
+  std::swap(present, o.present);
+  std::swap(zero_rows, o.zero_rows);
+  return *this;
+}
+
+bool dna_occ::is_dna(const buffer::buffer<unsigned char> &bwt) {
+  for (std::size_t i = 0; i < bwt.length(); ++i) {
+    if (bwt[i] >= 16 || (bwt[i] != 0 && letter_code[bwt[i]] < 0)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void dna_occ::allocate(std::size_t num_blocks) {
+  if (owns_blocks) {
+    free(blocks);
+  }
+  blocks = nullptr;
+  owns_blocks = true;
+  this->num_blocks = num_blocks;
+  void *p;
+  if (posix_memalign(&p, 64, num_blocks * sizeof(block)) != 0) {
+    throw std::bad_alloc();
+  }
+  blocks = static_cast<block *>(p);
+}
+
+void dna_occ::rank_all(std::size_t i, std::size_t *counts) const {
+  std::fill(counts, counts + alpha_size, 0);
+  const std::size_t k = i / block_size;
+  const block &b = blocks[k];
+  for (int code = 0; code < 4; ++code) {
+    counts[1 << code] = count_before_block(b, k, code) + count_in_block(b, code, i % block_size);
+  }
+  const std::size_t z = zeros_in_block(b, i);
+  counts[0] = (b.zeros >> 8) + z;
+  counts[1] -= z;
+}
+
+void dna_occ::rank_batch(std::size_t c, const std::size_t *positions, std::size_t count, std::size_t *ranks,
+    const rank_kernel &k) const {
+  int code = c > 0 && c < 16 ? letter_code[c] : -1;
+  if (code < 0) {
+    for (std::size_t j = 0; j < count; ++j) {
+      ranks[j] = c == 0 ? rank_zero(positions[j]) : 0;
+    }
+    return;
+  }
+  k.rank_batch(blocks, code, positions, count, ranks);
+  if (code == 0 && !zero_rows.empty()) {
+    for (std::size_t j = 0; j < count; ++j) {
+      ranks[j] -= zeros_in_block(blocks[positions[j] / block_size], positions[j]);
+    }
+  }
+}
+
+unsigned char dna_occ::access(std::size_t i) const {
+  const block &b = blocks[i / block_size];
+  const std::uint64_t *z = zero_rows.data() + (b.zeros >> 8);
+  for (std::size_t r = 0; r < (b.zeros & 0xff); ++r) {
+    if (z[r] == i) {
+      return 0;
+    }
+  }
+  std::size_t o = i % block_size;
+  return 1 << ((b.bits[o / 32] >> (2 * (o % 32))) & 3);
+}
+
+std::uint64_t dna_occ::zero_mask(std::size_t w) const {
+  const block &b = blocks[w / 2];
+  std::uint64_t mask = 0;
+  const std::uint64_t *z = zero_rows.data() + (b.zeros >> 8);
+  for (std::size_t r = 0; r < (b.zeros & 0xff); ++r) {
+    if (z[r] / 64 == w) {
+      mask |= 1ULL << (z[r] % 64);
+    }
+  }
+  return mask;
+}
+
+void dna_occ::serialize(std::ostream &out) const {
+  write_value<std::uint64_t>(out, n);
+  write_value<std::uint64_t>(out, alpha_size);
+  for (std::size_t c = 0; c < alpha_size; ++c) {
+    write_value<std::uint8_t>(out, present[c]);
+  }
+  write_value<std::uint64_t>(out, zero_rows.size());
+  write_array(out, zero_rows.data(), zero_rows.size());
+  write_value<std::uint64_t>(out, num_blocks);
+  write_padding(out, 64);
+  write_array(out, blocks, num_blocks);
+}
+
+void dna_occ::load(mapped_reader &in) {
+  std::istream &stream = in.stream();
+  n = read_value<std::uint64_t>(stream);
+  alpha_size = read_value<std::uint64_t>(stream);
+  if (alpha_size != 16) {
+    throw std::runtime_error("invalid index file");
+  }
+  present.assign(alpha_size, false);
+  for (std::size_t c = 0; c < alpha_size; ++c) {
+    present[c] = read_value<std::uint8_t>(stream) != 0;
+  }
+  zero_rows.resize(read_value<std::uint64_t>(stream));
+  read_array(stream, zero_rows.data(), zero_rows.size());
+  std::size_t length = read_value<std::uint64_t>(stream);
+  if (length != n / block_size + 1) {
+    throw std::runtime_error("invalid index file");
+  }
+  skip_padding(stream, 64);
+  if (owns_blocks) {
+    free(blocks);
+  }
+  num_blocks = length;
+  blocks = const_cast<block *>(in.array<block>(num_blocks));
+  owns_blocks = false;
+}
+
+}
@@ -0,0 +1,244 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_DNA_OCC_H_
+#define INDEX_DNA_OCC_H_
+
+#include "buffer/buffer.h"
+#include "index/mapped_file.h"
+#include "index/rank_kernels.h"
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <vector>
+
+namespace idx {
+
+/**
+ * Table des occurrences entrelacée pour une BWT sur ACGT (lettres 1, 2, 4 et 8).
+ * Chaque bloc de 64 octets (une ligne de cache) contient le nombre de A, C, G
+ * et de 0 avant le bloc suivi des 128 lettres du bloc codées sur 2 bits :
+ * rank(c, i) et rank_all(i) ne lisent donc qu'une seule ligne de cache.
+ * Les 0 (séparateurs des séquences) sont codés comme des A et conservés à part
+ * sous la forme de la liste triée de leurs lignes. Le bloc donne aussi le nombre
+ * de 0 qu'il contient : rank(1, i) n'est corrigé par la liste que pour les
+ * quelques blocs qui en ont.
+ * Chargés depuis un fichier projeté, les blocs y sont utilisés en place (le fichier
+ * les aligne sur 64 octets).
+ */
+class dna_occ {
+public:
+  static const std::uint64_t kind = 1;
+
+  dna_occ();
+  /**
+   * Construit la table de bwt avec num_threads threads, qui se partagent les blocs
+   */
+  dna_occ(const buffer::buffer<unsigned char> &bwt, std::size_t alpha_size, unsigned int num_threads = 1);
+  dna_occ(dna_occ &&o);
+  ~dna_occ();
+
+  dna_occ& operator=(dna_occ &&o);
+
+  /**
+   * Vrai si bwt ne contient que des 0, 1, 2, 4 et 8
+   */
+  static bool is_dna(const buffer::buffer<unsigned char> &bwt);
+
+  /**
+   * Nombre d'occurrences de la lettre c dans bwt[0 .. i - 1]
+   */
+  std::size_t rank(std::size_t c, std::size_t i) const {
+    if (c == 0) {
+      return rank_zero(i);
+    }
+    int code = c < 16 ? letter_code[c] : -1;
+    if (code < 0) {
+      return 0;
+    }
+    const block &b = blocks[i / block_size];
+    std::size_t r = count_before_block(b, i / block_size, code) + count_in_block(b, code, i % block_size);
+    return code == 0 ? r - zeros_in_block(b, i) : r;
+  }
+
+  /**
+   * counts[c] = rank(c, i) pour 0 <= c < get_alpha_size()
+   */
+  void rank_all(std::size_t i, std::size_t *counts) const;
+
+  /**
+   * ranks[k] = rank(c, positions[k]) pour 0 <= k < count, calculés par le noyau
+   * le plus rapide supporté par le processeur (voir idx::best_rank_kernel)
+   */
+  void rank_batch(std::size_t c, const std::size_t *positions, std::size_t count, std::size_t *ranks) const {
+    rank_batch(c, positions, count, ranks, *kernel);
+  }
+
+  /**
+   * Même chose avec le noyau k, qui doit être supporté par le processeur
+   */
+  void rank_batch(std::size_t c, const std::size_t *positions, std::size_t count, std::size_t *ranks,
+      const rank_kernel &k) const;
+
+  /**
+   * Demande le chargement en cache du bloc utilisé par rank(c, i)
+   */
+  void prefetch(std::size_t i) const {
+    __builtin_prefetch(blocks + i / block_size);
+  }
+
+  /**
+   * Masque des lignes 64 * w .. 64 * w + 63 qui portent la lettre c : le bit k vaut 1
+   * ssi bwt[64 * w + k] = c (voir ranges::basic_adaptive_frontier)
+   */
+  std::uint64_t letter_mask(std::size_t c, std::size_t w) const {
+    if (c == 0) {
+      return zero_mask(w);
+    }
+    int code = c < 16 ? letter_code[c] : -1;
+    if (code < 0) {
+      return 0;
+    }
+    const block &b = blocks[w / 2];
+    std::size_t half = 2 * (w % 2);
+    std::uint64_t mask = code_mask(b.bits[half], code) | (code_mask(b.bits[half + 1], code) << 32);
+    if (code == 0) {
+      // les 0 et les lignes après la fin de la BWT sont codés comme des A
+      mask &= ~zero_mask(w);
+      if (64 * (w + 1) > n) {
+        mask &= (1ULL << (n - 64 * w)) - 1;
+      }
+    }
+    return mask;
+  }
+
+  /**
+   * Nombre de lettres de code code avant le bloc b, d'indice k. Les blocs qui précèdent
+   * b sont pleins : le nombre de T est celui des lettres qui ne sont ni des A, C, G, ni des 0.
+   */
+  static std::size_t count_before_block(const dna_block &b, std::size_t k, int code) {
+    if (code < 3) {
+      return b.counts[code];
+    }
+    return block_size * k - b.counts[0] - b.counts[1] - b.counts[2] - (b.zeros >> 8);
+  }
+
+  /**
+   * Nombre de lettres de code code dans les len premières lettres du bloc b.
+   * Inlinée dans les noyaux scalaires de rank_kernels.cpp : __builtin_popcountll y est
+   * compilé avec les instructions autorisées pour le noyau.
+   */
+  static std::size_t count_in_block(const dna_block &b, int code, std::size_t len) {
+    const std::uint64_t pattern = 0x5555555555555555ULL * code;
+    std::size_t r = 0;
+    std::size_t w = 0;
+    for (; w < len / 32; ++w) {
+      std::uint64_t x = b.bits[w] ^ pattern;
+      r += __builtin_popcountll(~(x | (x >> 1)) & 0x5555555555555555ULL);
+    }
+    if (len % 32 != 0) {
+      std::uint64_t x = b.bits[w] ^ pattern;
+      std::uint64_t mask = (1ULL << (2 * (len % 32))) - 1;
+      r += __builtin_popcountll(~(x | (x >> 1)) & 0x5555555555555555ULL & mask);
+    }
+    return r;
+  }
+
+  unsigned char access(std::size_t i) const;
+
+  bool contains(std::size_t c) const {
+    return c < alpha_size && present[c];
+  }
+
+  std::size_t size() const {
+    return n;
+  }
+
+  std::size_t get_alpha_size() const {
+    return alpha_size;
+  }
+
+  void serialize(std::ostream &out) const;
+  void load(mapped_reader &in);
+
+private:
+  dna_occ(const dna_occ &o);
+  dna_occ& operator=(const dna_occ &o);
+
+  static const std::size_t block_size = 128;
+  static const int letter_code[16];
+
+  typedef dna_block block;
+
+  /**
+   * Masque sur 32 bits des lettres de code code parmi les 32 lettres du mot bits
+   */
+  static std::uint64_t code_mask(std::uint64_t bits, int code) {
+    std::uint64_t x = bits ^ (0x5555555555555555ULL * code);
+    x = ~(x | (x >> 1)) & 0x5555555555555555ULL;
+    // regroupe les bits pairs sur les 32 bits de poids faible
+    x = (x | (x >> 1)) & 0x3333333333333333ULL;
+    x = (x | (x >> 2)) & 0x0f0f0f0f0f0f0f0fULL;
+    x = (x | (x >> 4)) & 0x00ff00ff00ff00ffULL;
+    x = (x | (x >> 8)) & 0x0000ffff0000ffffULL;
+    x = (x | (x >> 16)) & 0x00000000ffffffffULL;
+    return x;
+  }
+
+  /**
+   * Masque des 0 parmi les lignes 64 * w .. 64 * w + 63
+   */
+  std::uint64_t zero_mask(std::size_t w) const;
+
+  std::size_t rank_zero(std::size_t i) const {
+    const block &b = blocks[i / block_size];
+    return (b.zeros >> 8) + zeros_in_block(b, i);
+  }
+
+  /**
+   * Nombre de 0 avant la ligne i dans son bloc b, lus dans zero_rows
+   * seulement si le bloc en contient
+   */
+  std::size_t zeros_in_block(const block &b, std::size_t i) const {
+    if ((b.zeros & 0xff) == 0) {
+      return 0;
+    }
+    const std::uint64_t *z = zero_rows.data() + (b.zeros >> 8);
+    std::size_t r = 0;
+    while (r < (b.zeros & 0xff) && z[r] < i) {
+      ++r;
+    }
+    return r;
+  }
+
+  void allocate(std::size_t num_blocks);
+
+  std::size_t n;
+  std::size_t alpha_size;
+  std::size_t num_blocks;
+  block *blocks;
+  bool owns_blocks; // faux si blocks est lu en place dans un fichier projeté (voir load)
+  std::vector<bool> present;
+  std::vector<std::uint64_t> zero_rows;
+  const rank_kernel *kernel;
+};
+
+}
+
+#endif /* INDEX_DNA_OCC_H_ */
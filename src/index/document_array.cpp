@@ -0,0 +1,71 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "index/document_array.h"
+
+#include <algorithm>
+
+#include <sdsl/construct.hpp>
+
+namespace idx {
+
+document_array::document_array() {
+}
+
+document_array::document_array(sdsl::int_vector<> &documents) {
+  sdsl::construct_im(wt, documents);
+  sdsl::util::clear(documents);
+}
+
+void document_array::list(std::size_t low, std::size_t high, std::vector<document_count> &out) const {
+  // au plus min(sigma, largeur) séquences distinctes dans l'intervalle
+  std::size_t max_documents = std::min<std::size_t>(wt.sigma, high - low + 1);
+  std::vector<sdsl::wt_int<>::value_type> symbols(max_documents);
+  std::vector<sdsl::wt_int<>::size_type> rank_low(max_documents);
+  std::vector<sdsl::wt_int<>::size_type> rank_high(max_documents);
+  sdsl::wt_int<>::size_type k = 0;
+  sdsl::interval_symbols(wt, low, high + 1, k, symbols, rank_low, rank_high);
+  std::size_t first = out.size();
+  for (std::size_t j = 0; j < k; ++j) {
+    out.push_back(document_count(symbols[j], rank_high[j] - rank_low[j]));
+  }
+  std::sort(out.begin() + first, out.end());
+}
+
+void document_array::merge(std::vector<document_count> &out) {
+  std::sort(out.begin(), out.end());
+  std::size_t last = 0;
+  for (std::size_t j = 0; j < out.size(); ++j) {
+    if (last > 0 && out[last - 1].first == out[j].first) {
+      out[last - 1].second += out[j].second;
+    } else {
+      out[last++] = out[j];
+    }
+  }
+  out.resize(last);
+}
+
+void document_array::serialize(std::ostream &out) const {
+  wt.serialize(out);
+}
+
+void document_array::load(std::istream &in) {
+  wt.load(in);
+}
+
+}
@@ -0,0 +1,76 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_DOCUMENT_ARRAY_H_
+#define INDEX_DOCUMENT_ARRAY_H_
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <utility>
+#include <vector>
+
+#include <sdsl/vectors.hpp>
+#include <sdsl/wavelet_trees.hpp>
+
+namespace idx {
+
+/**
+ * Tableau des documents : DA[i] est la séquence (voir idx::sequence_table) qui contient SA[i].
+ * Il est rangé dans un arbre d'ondelettes (sdsl::wt_int, n log(m) bits pour m séquences) :
+ * les séquences d'un intervalle de la BWT et leur nombre d'occurrences se lisent en descendant
+ * l'arbre dans les seules branches non vides (sdsl::interval_symbols), en O(d log m) pour d
+ * séquences distinctes, sans localiser les occurrences.
+ */
+class document_array {
+public:
+  typedef std::pair<std::size_t, std::uint64_t> document_count; // (séquence, nombre d'occurrences)
+
+  document_array();
+
+  /**
+   * documents[i] = DA[i] ; documents est vidé
+   */
+  explicit document_array(sdsl::int_vector<> &documents);
+
+  bool empty() const {
+    return wt.size() == 0;
+  }
+
+  /**
+   * Ajoute à out les séquences des lignes low .. high et leur nombre d'occurrences dans
+   * ces lignes, par séquence croissante
+   */
+  void list(std::size_t low, std::size_t high, std::vector<document_count> &out) const;
+
+  /**
+   * Trie out par séquence et regroupe les nombres d'occurrences d'une même séquence
+   * (résultats de list sur plusieurs intervalles)
+   */
+  static void merge(std::vector<document_count> &out);
+
+  void serialize(std::ostream &out) const;
+  void load(std::istream &in);
+
+private:
+  sdsl::wt_int<> wt;
+};
+
+}
+
+#endif /* INDEX_DOCUMENT_ARRAY_H_ */
@@ -0,0 +1,366 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_EXTERNAL_BWT_H_
+#define INDEX_EXTERNAL_BWT_H_
+
+#include "buffer/buffer.h"
+#include "index/index_format.h"
+#include "index/mapped_file.h"
+#include "index/packed_array.h"
+#include "index/sequence_table.h"
+#include "sais/sais.hxx"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <sdsl/vectors.hpp>
+
+namespace idx {
+
+/**
+ * Mémoire de travail par position d'un bloc de build_bwt_external : lettres du mot et leurs
+ * positions, mot renuméroté, table des suffixes du bloc et rangs d'insertion, sur 64 bits
+ */
+const std::size_t external_bytes_per_position = 5 * sizeof(std::int64_t);
+
+/**
+ * Fichiers d'une BWT partielle : une lettre par ligne et, si le SA est échantillonné,
+ * un octet par ligne (1 si la ligne est échantillonnée) et les numéros des échantillons
+ * des lignes échantillonnées (voir sequence_table), dans l'ordre des lignes
+ */
+struct external_bwt_files {
+  std::string bwt;
+  std::string flags;
+  std::string samples;
+
+  external_bwt_files(const std::string &prefix)
+      : bwt(prefix + ".bwt"), flags(prefix + ".flags"), samples(prefix + ".samples") {
+  }
+
+  void remove() const {
+    std::remove(bwt.c_str());
+    std::remove(flags.c_str());
+    std::remove(samples.c_str());
+  }
+};
+
+/**
+ * Écriture séquentielle des fichiers d'une BWT partielle, avec un tampon par fichier.
+ * sampler : positions échantillonnées, nul si le SA n'est pas échantillonné.
+ */
+class external_bwt_writer {
+public:
+  external_bwt_writer(const external_bwt_files &files, const position_sampler *sampler)
+      : sampler(sampler), bwt(files.bwt, std::ios::binary) {
+    if (sampler != nullptr) {
+      flags.open(files.flags, std::ios::binary);
+      samples.open(files.samples, std::ios::binary);
+    }
+    if (!bwt || !flags || !samples) {
+      throw std::runtime_error("unable to write temporary BWT files");
+    }
+  }
+
+  void write_row(unsigned char letter, bool is_sampled, std::uint64_t sample) {
+    bwt_buffer.push_back(letter);
+    if (sampler != nullptr) {
+      flags_buffer.push_back(is_sampled ? 1 : 0);
+      if (is_sampled) {
+        samples_buffer.push_back(sample);
+      }
+    }
+    if (bwt_buffer.size() == buffer_size) {
+      flush();
+    }
+  }
+
+  /**
+   * Écrit la ligne du suffixe qui commence en position
+   */
+  void write_suffix(unsigned char letter, std::size_t position) {
+    bool is_sampled = sampler != nullptr && sampler->contains(position);
+    write_row(letter, is_sampled, is_sampled ? sampler->number(position) : 0);
+  }
+
+  void close() {
+    flush();
+    bwt.close();
+    if (sampler != nullptr) {
+      flags.close();
+      samples.close();
+    }
+    if (!bwt || !flags || !samples) {
+      throw std::runtime_error("unable to write temporary BWT files");
+    }
+  }
+
+private:
+  static const std::size_t buffer_size = 1 << 20;
+
+  void flush() {
+    write_array(bwt, bwt_buffer.data(), bwt_buffer.size());
+    write_array(flags, flags_buffer.data(), flags_buffer.size());
+    write_array(samples, samples_buffer.data(), samples_buffer.size());
+    bwt_buffer.clear();
+    flags_buffer.clear();
+    samples_buffer.clear();
+  }
+
+  const position_sampler *sampler;
+  std::ofstream bwt;
+  std::ofstream flags;
+  std::ofstream samples;
+  std::vector<unsigned char> bwt_buffer;
+  std::vector<unsigned char> flags_buffer;
+  std::vector<std::uint64_t> samples_buffer;
+};
+
+/**
+ * Ajoute à la BWT partielle des fichiers files[current] les suffixes T[p..] de p = end - 1 à 0,
+ * block étant T[0 .. end - 1] (le reste de T, déjà dans la BWT partielle, n'est pas lu), par
+ * blocs de block_size positions traités de la droite vers la gauche. Avant l'appel, la BWT
+ * partielle contient les suffixes T[end..] : counts donne le nombre de chaque lettre de T[end..]
+ * et r0 la ligne du suffixe T[end..], qui porte un 0 provisoire. Ils sont mis à jour, et l'indice
+ * des fichiers qui contiennent le résultat est retourné.
+ * Pour ajouter le bloc T[p .. p + b - 1] :
+ * - g(i), le nombre d'anciens suffixes plus petits que T[i..], se calcule de la droite vers la
+ *   gauche par un pas de recherche arrière sur l'ancienne BWT : g(i) = C[T[i]] + rank(T[i], g(i + 1)),
+ *   en partant de la ligne r0 de T[p + b..], avec occ_type construit sur l'ancienne BWT projetée
+ *   en mémoire (ou first_occ pour le premier bloc, s'il n'est pas nul). Pour un séparateur
+ *   (T[i] = 0, voir sequence_table), les anciens suffixes plus petits sont le 0 final et ceux
+ *   qui suivent un séparateur et sont plus petits que T[i + 1..], c'est-à-dire les lignes
+ *   < g(i + 1) de lettre 0 sauf la ligne r0, dont le 0 est provisoire ;
+ * - deux nouveaux suffixes se comparent comme les mots formés des lettres (g(i), T[i]) terminés
+ *   par la lettre r0 + 1/2 de l'ancien suffixe T[p + b..] : les nouveaux suffixes sont donc triés
+ *   par saisxx sur ce mot de b + 1 lettres renumérotées ;
+ * - les nouveaux suffixes, triés, sont insérés en un seul passage séquentiel sur les anciens
+ *   fichiers : le nouveau suffixe i vient après les g(i) premières anciennes lignes. La ligne r0
+ *   reçoit sa lettre T[p + b - 1].
+ * Chaque bloc coûte donc une lecture et une écriture des fichiers et la construction de occ_type
+ * sur l'ancienne BWT.
+ * Si sampler n'est pas nul, les nouvelles lignes des positions qu'il contient sont échantillonnées.
+ */
+template<class occ_type, typename letter_type>
+int prepend_bwt_blocks(const letter_type *block, std::size_t end, std::size_t alpha_size,
+    const position_sampler *sampler, std::size_t block_size, const occ_type *first_occ,
+    const external_bwt_files files[2], int current, std::vector<std::size_t> &counts, std::size_t &r0,
+    unsigned int num_threads) {
+  while (end > 0) {
+    const std::size_t p = end > block_size ? end - block_size : 0;
+    const std::size_t b = end - p;
+    const external_bwt_files &in = files[current];
+    const external_bwt_files &out = files[1 - current];
+
+    std::vector<std::uint64_t> g(b);
+    {
+      std::unique_ptr<mapped_file> old_bwt;
+      std::unique_ptr<occ_type> built_occ;
+      const occ_type *occ = first_occ;
+      if (occ == nullptr) {
+        old_bwt.reset(new mapped_file(in.bwt));
+        buffer::buffer<unsigned char> view = buffer::buffer<unsigned char>::view(old_bwt->size(),
+            reinterpret_cast<const unsigned char *>(old_bwt->data()));
+        built_occ.reset(new occ_type(view, alpha_size, num_threads));
+        occ = built_occ.get();
+      }
+      first_occ = nullptr;
+      std::vector<std::size_t> C(alpha_size + 1, 0);
+      for (std::size_t c = 0; c < alpha_size; ++c) {
+        C[c + 1] = C[c] + counts[c];
+      }
+      std::size_t pos = r0;
+      for (std::size_t i = end; i > p; --i) {
+        unsigned char c = block[i - 1];
+        if (c == 0) {
+          pos = 1 + occ->rank(0, pos) - (r0 < pos ? 1 : 0);
+        } else {
+          pos = C[c] + occ->rank(c, pos);
+        }
+        g[i - 1 - p] = pos;
+      }
+    }
+
+    // mot des lettres (g(i), T[i]) terminé par r0 + 1/2, renuméroté pour saisxx
+    std::vector<std::int64_t> word(b + 1);
+    {
+      std::vector<std::pair<std::uint64_t, std::uint64_t> > keys(b + 1); // (lettre, position dans le mot)
+      for (std::size_t j = 0; j < b; ++j) {
+        keys[j] = std::make_pair(2 * g[j] * alpha_size + block[p + j], j);
+      }
+      keys[b] = std::make_pair((2 * r0 + 1) * alpha_size, b);
+      std::sort(keys.begin(), keys.end());
+      std::int64_t k = 0;
+      for (std::size_t j = 0; j <= b; ++j) {
+        if (j > 0 && keys[j].first != keys[j - 1].first) {
+          ++k;
+        }
+        word[keys[j].second] = k;
+      }
+      std::vector<std::pair<std::uint64_t, std::uint64_t> >().swap(keys);
+      std::vector<std::int64_t> sa(b + 1);
+      saisxx(word.data(), sa.data(), (std::int64_t) b + 1, k + 1);
+      word.swap(sa); // word reçoit la table des suffixes du mot
+    }
+
+    // fusion avec l'ancienne BWT
+    external_bwt_writer writer(out, sampler);
+    std::size_t new_r0 = 0;
+    {
+      mapped_file old_bwt(in.bwt);
+      std::unique_ptr<mapped_file> old_flags;
+      std::unique_ptr<mapped_file> old_samples;
+      if (sampler != nullptr) {
+        old_flags.reset(new mapped_file(in.flags));
+        old_samples.reset(new mapped_file(in.samples));
+      }
+      const std::size_t old_rows = old_bwt.size();
+      std::size_t old_row = 0;
+      std::size_t old_sample = 0;
+      std::size_t row = 0;
+      auto copy_old_rows = [&](std::size_t last) { // copie les anciennes lignes < last
+        for (; old_row < last; ++old_row, ++row) {
+          unsigned char letter = old_row == r0 ? block[end - 1] : (unsigned char) old_bwt.data()[old_row];
+          bool is_sampled = sampler != nullptr && old_flags->data()[old_row] != 0;
+          std::uint64_t sample = 0;
+          if (is_sampled) {
+            std::memcpy(&sample, old_samples->data() + 8 * old_sample++, 8);
+          }
+          writer.write_row(letter, is_sampled, sample);
+        }
+      };
+      for (std::size_t j = 0; j <= b; ++j) {
+        if ((std::size_t) word[j] == b) {
+          continue; // l'ancien suffixe T[end..]
+        }
+        std::size_t i = p + word[j];
+        copy_old_rows(g[word[j]]);
+        if (i == p) {
+          new_r0 = row;
+        }
+        writer.write_suffix(i == p ? 0 : block[i - 1], i);
+        ++row;
+      }
+      copy_old_rows(old_rows);
+    }
+
+    writer.close();
+    in.remove();
+    current = 1 - current;
+    for (std::size_t i = p; i < end; ++i) {
+      ++counts[block[i]];
+    }
+    r0 = new_r0;
+    end = p;
+  }
+  return current;
+}
+
+/**
+ * Charge dans sampled et SA_samples l'échantillon de la table des suffixes des fichiers
+ * d'une BWT partielle de n lignes, s'il y en a un, puis supprime ces fichiers (sauf celui de la BWT)
+ */
+inline void load_external_samples(const external_bwt_files &files, std::size_t n, bool with_samples,
+    sdsl::bit_vector &sampled, packed_array &SA_samples) {
+  if (with_samples) {
+    mapped_file flags(files.flags);
+    mapped_file samples(files.samples);
+    sampled = sdsl::bit_vector(n, 0);
+    std::size_t num_samples = samples.size() / 8;
+    SA_samples = packed_array(num_samples, sdsl::bits::hi(num_samples) + 1);
+    for (std::size_t i = 0, j = 0; i < n; ++i) {
+      if (flags.data()[i] != 0) {
+        sampled[i] = 1;
+        std::uint64_t sample;
+        std::memcpy(&sample, samples.data() + 8 * j, 8);
+        SA_samples.set(j++, sample);
+      }
+    }
+  }
+  std::remove(files.flags.c_str());
+  std::remove(files.samples.c_str());
+}
+
+/**
+ * Construit sur disque la BWT de text (terminé par le 0 final, les autres 0 étant des séparateurs
+ * de séquences, les lettres étant < alpha_size) sans jamais avoir en mémoire la table des suffixes
+ * entière.
+ *
+ * Le texte est découpé en blocs de max_memory / external_bytes_per_position positions, traités
+ * de la droite vers la gauche : après le bloc qui commence en p, les fichiers contiennent la BWT
+ * des suffixes T[p..], où la ligne du suffixe T[p..] porte un 0 provisoire. Le dernier bloc,
+ * qui se termine par le 0, est trié directement par saisxx, les autres sont ajoutés un à un
+ * par prepend_bwt_blocks. Le résultat est celui de la construction en mémoire.
+ *
+ * Si sequences n'est pas nul, les lignes des positions échantillonnées (voir sequence_table) sont
+ * conservées en même temps et chargées à la fin dans sampled et SA_samples.
+ * Les fichiers temporaires sont nommés à partir de prefix. Retourne le nom du fichier
+ * de la BWT, que l'appelant doit supprimer.
+ */
+template<class occ_type, typename letter_type>
+std::string build_bwt_external(const buffer::buffer<letter_type> &text, std::size_t alpha_size,
+    const sequence_table *sequences, std::size_t max_memory, const std::string &prefix, unsigned int num_threads,
+    sdsl::bit_vector &sampled, packed_array &SA_samples) {
+  const std::size_t n = text.length();
+  const std::size_t block_size = std::max<std::size_t>(1, max_memory / external_bytes_per_position);
+  const external_bwt_files files[2] = { external_bwt_files(prefix + ".0"), external_bwt_files(prefix + ".1") };
+  std::unique_ptr<position_sampler> sampler;
+  if (sequences != nullptr) {
+    sampler.reset(new position_sampler(*sequences));
+  }
+
+  // dernier bloc : T[p..] se termine par le 0, on le trie directement
+  const std::size_t p = n > block_size ? n - block_size : 0;
+  const std::size_t b = n - p;
+  std::vector<std::size_t> counts(alpha_size, 0); // lettres des suffixes déjà triés
+  std::size_t r0 = 0; // ligne du suffixe T[p..]
+  {
+    external_bwt_writer writer(files[0], sampler.get());
+    std::vector<std::int64_t> sa(b);
+    saisxx(text.data() + p, sa.data() + 1, (std::int64_t) b - 1, (std::int64_t) alpha_size);
+    sa[0] = b - 1;
+    for (std::size_t j = 0; j < b; ++j) {
+      std::size_t i = p + sa[j];
+      if (i == p) {
+        r0 = j;
+      }
+      writer.write_suffix(i == p ? 0 : text[i - 1], i);
+    }
+    writer.close();
+  }
+  for (std::size_t i = p; i < n; ++i) {
+    ++counts[text[i]];
+  }
+
+  int current = prepend_bwt_blocks<occ_type>(text.data(), p, alpha_size, sampler.get(), block_size,
+      nullptr, files, 0, counts, r0, num_threads);
+  load_external_samples(files[current], n, sampler != nullptr, sampled, SA_samples);
+  return files[current].bwt;
+}
+
+}
+
+#endif /* INDEX_EXTERNAL_BWT_H_ */
@@ -0,0 +1,126 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_INDEX_FORMAT_H_
+#define INDEX_INDEX_FORMAT_H_
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <istream>
+#include <ostream>
+#include <stdexcept>
+#include <string>
+
+namespace idx {
+
+/**
+ * Format du fichier d'index (tous les entiers en little endian) :
+ *   magic (8 octets) | version | occ_type::kind | n | alpha_size | sa_sample_rate
+ *   | padding | C[0 .. alpha_size]
+ *   | occ (voir compact_rank::serialize et dna_occ::serialize) | kmers (voir kmer_table::serialize)
+ *   | has_occ_rev | occ_rev (seulement si has_occ_rev != 0)
+ *   | sequences (voir sequence_table::serialize) | sampled | sampled_rank | SA_samples
+ *   | has_text | text (seulement si has_text != 0, voir packed_text::serialize)
+ *   | has_documents | documents (seulement si has_documents != 0, voir document_array::serialize)
+ * L'échantillon de la table des suffixes, la copie du texte et le tableau des documents sont
+ * à la fin pour que le comptage des occurrences puisse s'arrêter de lire avant eux.
+ * Les tableaux bruts (C, blocs de dna_occ, mots de idx::packed_array et de packed_text) sont
+ * précédés de 0 qui les alignent dans le fichier (sur 64 octets pour les blocs de dna_occ,
+ * 8 pour les autres) : ils sont utilisés en place dans le fichier projeté (voir mapped_reader).
+ * La version doit être incrémentée à chaque changement de format.
+ */
+const char index_magic[8] = { 'D', 'S', 'B', 'W', 'T', 'I', 'D', 'X' };
+const std::uint64_t index_version = 12;
+
+template<typename T>
+void write_value(std::ostream &out, const T &v) {
+  out.write(reinterpret_cast<const char *>(&v), sizeof(T));
+}
+
+template<typename T>
+void write_array(std::ostream &out, const T *a, std::size_t n) {
+  out.write(reinterpret_cast<const char *>(a), n * sizeof(T));
+}
+
+template<typename T>
+T read_value(std::istream &in) {
+  T v;
+  if (!in.read(reinterpret_cast<char *>(&v), sizeof(T))) {
+    throw std::runtime_error("truncated index file");
+  }
+  return v;
+}
+
+template<typename T>
+void read_array(std::istream &in, T *a, std::size_t n) {
+  if (!in.read(reinterpret_cast<char *>(a), n * sizeof(T))) {
+    throw std::runtime_error("truncated index file");
+  }
+}
+
+/**
+ * Complète le flux avec des 0 jusqu'au prochain multiple de alignment (au plus 64) :
+ * un tableau écrit ensuite peut être utilisé en place dans le fichier projeté (voir mapped_reader)
+ */
+inline void write_padding(std::ostream &out, std::size_t alignment = 8) {
+  static const char zeros[64] = { 0 };
+  std::streamoff pos = out.tellp();
+  if (pos % alignment != 0) {
+    out.write(zeros, alignment - pos % alignment);
+  }
+}
+
+inline void skip_padding(std::istream &in, std::size_t alignment = 8) {
+  std::streamoff pos = in.tellg();
+  if (pos % alignment != 0) {
+    in.seekg(alignment - pos % alignment, std::ios_base::cur);
+  }
+}
+
+inline void write_header(std::ostream &out) {
+  out.write(index_magic, sizeof(index_magic));
+  write_value(out, index_version);
+}
+
+inline void check_header(std::istream &in) {
+  char magic[sizeof(index_magic)];
+  read_array(in, magic, sizeof(magic));
+  if (std::memcmp(magic, index_magic, sizeof(magic)) != 0) {
+    throw std::runtime_error("not a dsbwt index file");
+  }
+  if (read_value<std::uint64_t>(in) != index_version) {
+    throw std::runtime_error("unsupported index version, please rebuild the index");
+  }
+}
+
+/**
+ * Retourne le type de structure de rang (occ_type::kind) de l'index stocké dans path
+ */
+inline std::uint64_t read_occ_kind(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in.is_open()) {
+    throw std::runtime_error("unable to open index file");
+  }
+  check_header(in);
+  return read_value<std::uint64_t>(in);
+}
+
+}
+
+#endif /* INDEX_INDEX_FORMAT_H_ */
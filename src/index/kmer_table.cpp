@@ -16,11 +16,32 @@
  * along with this program.  If not, see <http://www.gnu.org/licenses/>.
  **/
 
-#include "range.h"
+#include "index/kmer_table.h"
+#include "index/index_format.h"
 
-std::ostream& operator<<(std::ostream& stream, const ranges::range& r) {
-  stream << "[" << r.get_low() << ", " << r.get_high() << "]";
+namespace idx {
 
-  return stream;
+const std::size_t kmer_table::max_kmer_length;
+
+kmer_table::kmer_table() : k(0) {
+}
+
+void kmer_table::serialize(std::ostream &out) const {
+  write_value<std::uint64_t>(out, k);
+  low.serialize(out);
+  count.serialize(out);
 }
 
+void kmer_table::load(mapped_reader &in) {
+  k = read_value<std::uint64_t>(in.stream());
+  if (k > max_kmer_length) {
+    throw std::runtime_error("invalid index file");
+  }
+  low.load(in);
+  count.load(in);
+  if (low.size() != num_kmers() || count.size() != num_kmers()) {
+    throw std::runtime_error("invalid index file");
+  }
+}
+
+}
@@ -0,0 +1,136 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_KMER_TABLE_H_
+#define INDEX_KMER_TABLE_H_
+
+#include "index/mapped_file.h"
+#include "index/packed_array.h"
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+
+#include <sdsl/vectors.hpp>
+
+namespace idx {
+
+/**
+ * Table des intervalles de la BWT de tous les mots de longueur k sur ACGT (lettres 1, 2, 4 et 8,
+ * comme dans idx::dna_occ). Le mot w = w[0] .. w[k - 1] est codé par
+ * code(w) = sum_i letter_code(w[i]) * 4^(k - 1 - i), l'ordre des codes est donc l'ordre
+ * lexicographique des mots et celui de leurs intervalles dans la BWT.
+ * Les k premières étapes de la recherche arrière d'un motif se réduisent à la lecture
+ * des intervalles des mots compatibles avec ses k dernières lettres.
+ * Occupe 2 * 4^k entiers de log(n) bits : k = 0 (pas de table) par défaut.
+ * Chargée depuis un fichier projeté, la table y est utilisée en place.
+ */
+class kmer_table {
+public:
+  static const std::size_t max_kmer_length = 16;
+
+  kmer_table();
+
+  /**
+   * occ : structure de rang sur la BWT, C : début des buckets (voir preproc_backward_search2).
+   * Les intervalles sont obtenus par un parcours en profondeur des mots étendus à gauche,
+   * en 4^k * 4 / 3 étapes de la recherche arrière ; un mot absent n'est pas étendu.
+   */
+  template<class occ_type>
+  kmer_table(const occ_type &occ, const std::size_t *C, std::size_t k) : k(k) {
+    std::size_t width = sdsl::bits::hi(occ.size()) + 1;
+    low = packed_array(num_kmers(), width);
+    count = packed_array(num_kmers(), width);
+    if (k == 0) {
+      return;
+    }
+
+    struct node {
+      std::uint64_t code;
+      std::size_t length;
+      std::size_t low; // intervalle [low, high[ des lignes commençant par le mot
+      std::size_t high;
+    };
+    std::vector<node> stack;
+    for (int a = 0; a < 4; ++a) {
+      std::size_t c = 1 << a;
+      if (C[c] < C[c + 1]) {
+        stack.push_back(node { (std::uint64_t) a, 1, C[c], C[c + 1] });
+      }
+    }
+    while (!stack.empty()) {
+      node v = stack.back();
+      stack.pop_back();
+      if (v.length == k) {
+        low.set(v.code, v.low);
+        count.set(v.code, v.high - v.low);
+        continue;
+      }
+      for (int a = 0; a < 4; ++a) {
+        std::size_t c = 1 << a;
+        std::size_t r1 = C[c] + occ.rank(c, v.low);
+        std::size_t r2 = C[c] + occ.rank(c, v.high);
+        if (r1 < r2) {
+          stack.push_back(node { ((std::uint64_t) a << (2 * v.length)) + v.code, v.length + 1, r1, r2 });
+        }
+      }
+    }
+  }
+
+  /**
+   * Longueur des mots de la table, 0 s'il n'y a pas de table
+   */
+  std::size_t get_k() const {
+    return k;
+  }
+
+  std::uint64_t num_kmers() const {
+    return k == 0 ? 0 : (std::uint64_t) 1 << (2 * k);
+  }
+
+  /**
+   * Nombre de lignes de la BWT commençant par le mot de code code,
+   * qui occupent les lignes get_low(code) .. get_low(code) + get_count(code) - 1
+   */
+  std::size_t get_count(std::uint64_t code) const {
+    return count[code];
+  }
+
+  std::size_t get_low(std::uint64_t code) const {
+    return low[code];
+  }
+
+  /**
+   * Code (0 à 3) de la lettre c (1, 2, 4 ou 8)
+   */
+  static int letter_code(std::size_t c) {
+    return __builtin_ctzll(c);
+  }
+
+  void serialize(std::ostream &out) const;
+  void load(mapped_reader &in);
+
+private:
+  std::size_t k;
+  packed_array low;
+  packed_array count;
+};
+
+}
+
+#endif /* INDEX_KMER_TABLE_H_ */
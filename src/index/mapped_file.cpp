@@ -0,0 +1,93 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "index/mapped_file.h"
+
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace idx {
+
+mapped_file::mapped_file(const std::string &path) : addr(nullptr), length(0) {
+  int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) {
+    throw std::runtime_error("unable to open file");
+  }
+
+  struct stat st;
+  if (fstat(fd, &st) < 0) {
+    close(fd);
+    throw std::runtime_error("unable to stat file");
+  }
+  length = st.st_size;
+
+  if (length > 0) {
+    void *p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (p == MAP_FAILED) {
+      close(fd);
+      throw std::runtime_error("unable to map file");
+    }
+    addr = static_cast<const char *>(p);
+  }
+  close(fd);
+}
+
+mapped_file::~mapped_file() {
+  if (addr != nullptr) {
+    munmap(const_cast<char *>(addr), length);
+  }
+}
+
+memory_streambuf::memory_streambuf(const char *begin, std::size_t length) {
+  char *p = const_cast<char *>(begin);
+  setg(p, p, p + length);
+}
+
+memory_streambuf::pos_type memory_streambuf::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) {
+  if (!(which & std::ios_base::in)) {
+    return pos_type(off_type(-1));
+  }
+
+  char *p;
+  if (dir == std::ios_base::beg) {
+    p = eback() + off;
+  } else if (dir == std::ios_base::cur) {
+    p = gptr() + off;
+  } else {
+    p = egptr() + off;
+  }
+
+  if (p < eback() || p > egptr()) {
+    return pos_type(off_type(-1));
+  }
+  setg(eback(), p, egptr());
+  return pos_type(p - eback());
+}
+
+memory_streambuf::pos_type memory_streambuf::seekpos(pos_type pos, std::ios_base::openmode which) {
+  return seekoff(off_type(pos), std::ios_base::beg, which);
+}
+
+mapped_reader::mapped_reader(const mapped_file &file) : file(file), sb(file.data(), file.size()), in(&sb) {
+}
+
+}
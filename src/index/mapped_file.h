@@ -0,0 +1,117 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_MAPPED_FILE_H_
+#define INDEX_MAPPED_FILE_H_
+
+#include <cstddef>
+#include <istream>
+#include <stdexcept>
+#include <streambuf>
+#include <string>
+
+namespace idx {
+
+/**
+ * Fichier projeté en mémoire (lecture seule).
+ * Les pages ne sont chargées qu'à la demande, ce qui permet de lire les fichiers
+ * temporaires de la construction (BWT partielles) et d'utiliser en place les gros
+ * tableaux d'un index (voir mapped_reader) sans les recopier : les processus qui
+ * cherchent dans le même index partagent alors ses pages.
+ */
+class mapped_file {
+public:
+  mapped_file(const std::string &path);
+  ~mapped_file();
+
+  const char *data() const {
+    return addr;
+  }
+
+  std::size_t size() const {
+    return length;
+  }
+
+private:
+  mapped_file(const mapped_file &f);
+  mapped_file& operator=(const mapped_file &f);
+
+private:
+  const char *addr;
+  std::size_t length;
+};
+
+/**
+ * streambuf en lecture sur une zone mémoire, pour pouvoir utiliser
+ * les fonctions load(std::istream &) de sdsl sur un fichier projeté.
+ */
+class memory_streambuf : public std::streambuf {
+public:
+  memory_streambuf(const char *begin, std::size_t length);
+
+  std::size_t offset() const {
+    return gptr() - eback();
+  }
+
+protected:
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which);
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which);
+};
+
+/**
+ * Lecture séquentielle d'un fichier projeté : les tableaux bruts sont utilisés en place
+ * (voir array), les autres structures (celles de sdsl) sont lues dans stream() et recopiées.
+ */
+class mapped_reader {
+public:
+  explicit mapped_reader(const mapped_file &file);
+
+  std::istream &stream() {
+    return in;
+  }
+
+  /**
+   * Retourne les n valeurs de type T à la position courante, qui doit être alignée
+   * pour T (voir write_padding), et passe à la suite
+   */
+  template<typename T>
+  const T *array(std::size_t n) {
+    std::size_t offset = sb.offset();
+    if (offset % alignof(T) != 0) {
+      throw std::runtime_error("invalid index file");
+    }
+    if (n > (file.size() - offset) / sizeof(T)) {
+      throw std::runtime_error("truncated index file");
+    }
+    in.seekg(n * sizeof(T), std::ios_base::cur);
+    return reinterpret_cast<const T *>(file.data() + offset);
+  }
+
+private:
+  mapped_reader(const mapped_reader &r);
+  mapped_reader& operator=(const mapped_reader &r);
+
+private:
+  const mapped_file &file;
+  memory_streambuf sb;
+  std::istream in;
+};
+
+}
+
+#endif /* INDEX_MAPPED_FILE_H_ */
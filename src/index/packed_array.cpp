@@ -0,0 +1,69 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "index/packed_array.h"
+#include "index/index_format.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <utility>
+
+namespace idx {
+
+packed_array::packed_array() : n(0), width(1), mask(1) {
+}
+
+packed_array::packed_array(std::size_t n, std::size_t width)
+    : n(n), width(width), mask(width == 64 ? ~0ULL : (1ULL << width) - 1), words(num_words(n, width)) {
+  assert(width >= 1 && width <= 64);
+  std::fill(words.data(), words.data() + words.length(), 0);
+}
+
+packed_array::packed_array(packed_array &&o) : n(o.n), width(o.width), mask(o.mask), words(std::move(o.words)) {
+  o.n = 0;
+}
+
+packed_array& packed_array::operator=(packed_array &&o) {
+  n = o.n;
+  width = o.width;
+  mask = o.mask;
+  words = std::move(o.words);
+  o.n = 0;
+  return *this;
+}
+
+void packed_array::serialize(std::ostream &out) const {
+  write_value<std::uint64_t>(out, n);
+  write_value<std::uint64_t>(out, width);
+  write_padding(out);
+  write_array(out, words.data(), words.length());
+}
+
+void packed_array::load(mapped_reader &in) {
+  n = read_value<std::uint64_t>(in.stream());
+  width = read_value<std::uint64_t>(in.stream());
+  if (width < 1 || width > 64 || n > ~0ULL / width - 63) {
+    throw std::runtime_error("invalid index file");
+  }
+  mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+  std::size_t length = num_words(n, width);
+  skip_padding(in.stream());
+  words = buffer::buffer<std::uint64_t>::view(length, in.array<std::uint64_t>(length));
+}
+
+}
@@ -0,0 +1,101 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_PACKED_ARRAY_H_
+#define INDEX_PACKED_ARRAY_H_
+
+#include "buffer/buffer.h"
+#include "index/mapped_file.h"
+
+#include <cstdint>
+#include <ostream>
+
+namespace idx {
+
+/**
+ * Tableau de n entiers de width bits (1 à 64), rangés les uns à la suite des autres
+ * dans des mots de 64 bits, comme sdsl::int_vector<>. Chargé depuis un fichier projeté,
+ * ses mots y sont utilisés en place (voir load).
+ */
+class packed_array {
+public:
+  packed_array();
+
+  /**
+   * n valeurs nulles
+   */
+  packed_array(std::size_t n, std::size_t width);
+
+  packed_array(packed_array &&o);
+
+  packed_array& operator=(packed_array &&o);
+
+  std::uint64_t operator[](std::size_t i) const {
+    std::size_t b = i * width;
+    std::uint64_t v = words[b / 64] >> (b % 64);
+    if (b % 64 + width > 64) {
+      v |= words[b / 64 + 1] << (64 - b % 64);
+    }
+    return v & mask;
+  }
+
+  /**
+   * Range v (qui doit tenir sur width bits) à l'indice i. Les mots étant partagés
+   * entre valeurs voisines, deux threads ne doivent pas écrire dans le même mot.
+   */
+  void set(std::size_t i, std::uint64_t v) {
+    std::size_t b = i * width;
+    words[b / 64] = (words[b / 64] & ~(mask << (b % 64))) | (v << (b % 64));
+    if (b % 64 + width > 64) {
+      std::size_t shift = 64 - b % 64;
+      words[b / 64 + 1] = (words[b / 64 + 1] & ~(mask >> shift)) | (v >> shift);
+    }
+  }
+
+  std::size_t size() const {
+    return n;
+  }
+
+  std::size_t get_width() const {
+    return width;
+  }
+
+  void serialize(std::ostream &out) const;
+
+  /**
+   * Les mots sont lus en place dans le fichier projeté de in
+   */
+  void load(mapped_reader &in);
+
+private:
+  packed_array(const packed_array &o);
+  packed_array& operator=(const packed_array &o);
+
+  static std::size_t num_words(std::size_t n, std::size_t width) {
+    return (n * width + 63) / 64;
+  }
+
+  std::size_t n;
+  std::size_t width;
+  std::uint64_t mask;
+  buffer::buffer<std::uint64_t> words;
+};
+
+}
+
+#endif /* INDEX_PACKED_ARRAY_H_ */
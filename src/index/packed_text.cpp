@@ -0,0 +1,60 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "index/packed_text.h"
+#include "index/index_format.h"
+
+#include <algorithm>
+#include <stdexcept>
+
+namespace idx {
+
+packed_text::packed_text() : n(0) {
+}
+
+packed_text::packed_text(const buffer::buffer<unsigned char> &text) : n(text.length() - 1), words((n + 31) / 32) {
+  std::fill(words.data(), words.data() + words.length(), 0);
+  static const int letter_code[16] = { -1, 0, 1, -1, 2, -1, -1, -1, 3, -1, -1, -1, -1, -1, -1, -1 };
+  for (std::size_t i = 0; i < n; ++i) {
+    // les séparateurs de séquences (0) sont codés comme A
+    int code = text[i] == 0 ? 0 : text[i] < 16 ? letter_code[text[i]] : -1;
+    if (code < 0) {
+      throw std::runtime_error("packed_text: text is not over ACGT");
+    }
+    words[i / 32] |= (std::uint64_t) code << (2 * (i % 32));
+  }
+}
+
+void packed_text::serialize(std::ostream &out) const {
+  write_value<std::uint64_t>(out, n);
+  write_value<std::uint64_t>(out, words.length());
+  write_padding(out);
+  write_array(out, words.data(), words.length());
+}
+
+void packed_text::load(mapped_reader &in) {
+  n = read_value<std::uint64_t>(in.stream());
+  std::size_t length = read_value<std::uint64_t>(in.stream());
+  if (length != (n + 31) / 32) {
+    throw std::runtime_error("invalid index file");
+  }
+  skip_padding(in.stream());
+  words = buffer::buffer<std::uint64_t>::view(length, in.array<std::uint64_t>(length));
+}
+
+}
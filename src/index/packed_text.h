@@ -0,0 +1,75 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_PACKED_TEXT_H_
+#define INDEX_PACKED_TEXT_H_
+
+#include "buffer/buffer.h"
+#include "index/mapped_file.h"
+
+#include <cstdint>
+#include <ostream>
+
+namespace idx {
+
+/**
+ * Copie du texte sur ACGT (lettres 1, 2, 4 et 8, comme dans idx::dna_occ) codée sur 2 bits
+ * par lettre, 32 lettres par mot : n / 4 octets. Permet de vérifier directement la fin
+ * d'un motif autour d'une occurrence localisée (voir batch_search).
+ * Les séparateurs de séquences ne sont pas conservés (ils sont lus comme des A) : les bornes
+ * des séquences sont dans idx::sequence_table.
+ * Chargés depuis un fichier projeté, les mots y sont utilisés en place.
+ */
+class packed_text {
+public:
+  packed_text();
+
+  /**
+   * text se termine par le 0 final, qui n'est pas conservé ; ses autres 0 sont des séparateurs
+   */
+  packed_text(const buffer::buffer<unsigned char> &text);
+
+  /**
+   * Retourne la lettre text[i], pour 0 <= i < size()
+   */
+  unsigned char operator[](std::size_t i) const {
+    return 1 << ((words[i / 32] >> (2 * (i % 32))) & 3);
+  }
+
+  /**
+   * Longueur du texte, sans le 0 final
+   */
+  std::size_t size() const {
+    return n;
+  }
+
+  bool empty() const {
+    return n == 0;
+  }
+
+  void serialize(std::ostream &out) const;
+  void load(mapped_reader &in);
+
+private:
+  std::size_t n;
+  buffer::buffer<std::uint64_t> words;
+};
+
+}
+
+#endif /* INDEX_PACKED_TEXT_H_ */
@@ -0,0 +1,97 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_PARALLEL_H_
+#define INDEX_PARALLEL_H_
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace idx {
+
+/**
+ * Découpe [0, count) en au plus num_threads tranches contiguës dont les bornes sont
+ * des multiples de grain (sauf la fin de la dernière) et appelle f(t, begin, end) pour
+ * la tranche t, chaque tranche dans son propre thread (la première dans le thread appelant).
+ * Les tranches sont numérotées dans l'ordre de [0, count) ; t < num_threads.
+ */
+template<class F>
+void parallel_chunks(std::size_t count, std::size_t grain, unsigned int num_threads, F f) {
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  std::size_t chunk = (count + num_threads - 1) / num_threads;
+  chunk = std::max<std::size_t>(grain, (chunk + grain - 1) / grain * grain);
+  std::vector<std::thread> threads;
+  for (unsigned int t = 1; t < num_threads && t * chunk < count; ++t) {
+    threads.emplace_back(f, t, t * chunk, std::min(count, (t + 1) * chunk));
+  }
+  f(0u, std::size_t(0), std::min(count, chunk));
+  for (std::thread &th : threads) {
+    th.join();
+  }
+}
+
+/**
+ * Appelle f(t) pour 0 <= t < num_threads, chaque appel dans son propre thread
+ * (le premier dans le thread appelant), et attend la fin de tous les appels
+ */
+template<class F>
+void parallel_threads(unsigned int num_threads, F f) {
+  std::vector<std::thread> threads;
+  for (unsigned int t = 1; t < num_threads; ++t) {
+    threads.emplace_back(f, t);
+  }
+  f(0u);
+  for (std::thread &th : threads) {
+    th.join();
+  }
+}
+
+/**
+ * Appelle f(t, k) pour 0 <= k < num_tasks avec num_threads threads qui se partagent
+ * les tâches au fur et à mesure ; t < num_threads est le numéro du thread qui traite la tâche k
+ */
+template<class F>
+void parallel_thread_tasks(std::size_t num_tasks, unsigned int num_threads, F f) {
+  std::atomic<std::size_t> next_task(0);
+  num_threads = std::max<std::size_t>(1, std::min<std::size_t>(num_threads, num_tasks));
+  parallel_threads(num_threads, [&](unsigned int t) {
+    for (std::size_t k = next_task++; k < num_tasks; k = next_task++) {
+      f(t, k);
+    }
+  });
+}
+
+/**
+ * Appelle f(k) pour 0 <= k < num_tasks avec num_threads threads qui se partagent
+ * les tâches au fur et à mesure
+ */
+template<class F>
+void parallel_tasks(std::size_t num_tasks, unsigned int num_threads, F f) {
+  parallel_thread_tasks(num_tasks, num_threads, [&](unsigned int, std::size_t k) {
+    f(k);
+  });
+}
+
+}
+
+#endif /* INDEX_PARALLEL_H_ */
@@ -0,0 +1,264 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_PARALLEL_SUFFIX_SORT_H_
+#define INDEX_PARALLEL_SUFFIX_SORT_H_
+
+#include "index/parallel.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace idx {
+
+/**
+ * Trie [first, last) selon comp avec num_threads threads : chaque thread trie une tranche,
+ * puis les tranches sont fusionnées deux à deux
+ */
+template<class iterator, class compare>
+void parallel_sort(iterator first, iterator last, compare comp, unsigned int num_threads) {
+  const std::size_t len = last - first;
+  if (num_threads <= 1 || len < (1 << 16)) {
+    std::sort(first, last, comp);
+    return;
+  }
+  std::vector<iterator> bounds(num_threads + 1);
+  for (unsigned int p = 0; p <= num_threads; ++p) {
+    bounds[p] = first + len * p / num_threads;
+  }
+  parallel_tasks(num_threads, num_threads, [&](std::size_t p) {
+    std::sort(bounds[p], bounds[p + 1], comp);
+  });
+  for (std::size_t width = 1; width < num_threads; width *= 2) {
+    parallel_tasks((num_threads + 2 * width - 1) / (2 * width), num_threads, [&](std::size_t m) {
+      std::size_t a = 2 * m * width;
+      std::size_t mid = std::min<std::size_t>(a + width, num_threads);
+      std::size_t end = std::min<std::size_t>(a + 2 * width, num_threads);
+      if (mid < end) {
+        std::inplace_merge(bounds[a], bounds[mid], bounds[end], comp);
+      }
+    });
+  }
+}
+
+/**
+ * Table des suffixes de text[0 .. n - 1], dont la dernière lettre est le 0 final (les autres 0
+ * étant des séparateurs de séquences, les lettres < alpha_size), calculée avec num_threads threads par doublement
+ * de préfixe (Manber–Myers, avec les rangs « fin de groupe » de Larsson–Sadakane).
+ *
+ * Les suffixes sont d'abord répartis par tri par dénombrement selon leurs k premières lettres,
+ * k étant choisi pour qu'il y ait au plus 2^16 seaux (k = 6 sur ACGT et le 0). Ensuite, à
+ * chaque tour, les groupes de suffixes ayant les mêmes h premières lettres sont triés selon le
+ * rang du suffixe qui commence h lettres plus loin, puis redécoupés : h double à chaque tour,
+ * et seuls les groupes non réduits à un suffixe sont retriés. Le tri d'un tour ne fait que lire
+ * les rangs et le redécoupage n'écrit que les rangs des suffixes de ses groupes, ce qui permet
+ * de répartir les groupes entre les threads sans verrou.
+ *
+ * Le résultat est celui de saisxx (sa[0] = n - 1). Il faut n valeurs de sa_type de plus que
+ * saisxx pour les rangs, plus un octet par lettre et deux valeurs de sa_type par suffixe
+ * des groupes en cours de tri.
+ */
+template<typename sa_type, typename letter_type>
+void parallel_suffix_sort(const letter_type *text, std::size_t n, std::size_t alpha_size, sa_type *sa,
+    unsigned int num_threads) {
+  if (n == 0) {
+    return;
+  }
+  if (num_threads == 0) {
+    num_threads = 1;
+  }
+  const std::size_t grain = 1 << 12; // taille minimale d'un lot de groupes
+  const std::size_t max_buckets = 1 << 16;
+
+  // codes denses des lettres présentes (le 0 final a le code 0)
+  std::vector<std::vector<char> > seen(num_threads, std::vector<char>(alpha_size, 0));
+  parallel_chunks(n, 1, num_threads, [&](unsigned int t, std::size_t begin, std::size_t end) {
+    for (std::size_t i = begin; i < end; ++i) {
+      seen[t][text[i]] = 1;
+    }
+  });
+  std::vector<std::size_t> code(alpha_size, 0);
+  std::size_t sigma = 0;
+  for (std::size_t c = 0; c < alpha_size; ++c) {
+    for (unsigned int t = 0; t < num_threads; ++t) {
+      if (seen[t][c]) {
+        code[c] = sigma++;
+        break;
+      }
+    }
+  }
+
+  std::size_t k = 1;
+  std::size_t num_buckets = sigma;
+  while (k < n && num_buckets * sigma <= max_buckets) {
+    num_buckets *= sigma;
+    ++k;
+  }
+  const std::size_t high = num_buckets / sigma; // poids de la première lettre d'une clé
+
+  // clé(i) : les k premières lettres du suffixe i, complétées par des 0
+  auto first_key = [&](std::size_t i) {
+    std::size_t key = 0;
+    for (std::size_t j = 0; j < k; ++j) {
+      key = key * sigma + (i + j < n ? code[text[i + j]] : 0);
+    }
+    return key;
+  };
+  auto next_key = [&](std::size_t key, std::size_t i) { // clé(i + 1) à partir de clé(i)
+    return (key % high) * sigma + (i + k < n ? code[text[i + k]] : 0);
+  };
+
+  // tri par dénombrement des clés, tranche par tranche
+  std::vector<std::size_t> counts(num_threads * num_buckets, 0);
+  parallel_chunks(n, 1, num_threads, [&](unsigned int t, std::size_t begin, std::size_t end) {
+    std::size_t *local = counts.data() + t * num_buckets;
+    for (std::size_t i = begin, key = first_key(begin); i < end; key = next_key(key, i), ++i) {
+      ++local[key];
+    }
+  });
+  std::vector<sa_type> bucket_end(num_buckets);
+  std::vector<std::pair<std::size_t, std::size_t> > groups; // groupes [début, fin) de plus d'un suffixe
+  std::size_t total = 0;
+  for (std::size_t b = 0; b < num_buckets; ++b) {
+    std::size_t start = total;
+    for (unsigned int t = 0; t < num_threads; ++t) {
+      std::size_t c = counts[t * num_buckets + b];
+      counts[t * num_buckets + b] = total;
+      total += c;
+    }
+    bucket_end[b] = total - 1;
+    if (total - start > 1) {
+      groups.push_back(std::make_pair(start, total));
+    }
+  }
+  std::vector<sa_type> rank(n);
+  parallel_chunks(n, 1, num_threads, [&](unsigned int t, std::size_t begin, std::size_t end) {
+    std::size_t *next = counts.data() + t * num_buckets;
+    for (std::size_t i = begin, key = first_key(begin); i < end; key = next_key(key, i), ++i) {
+      sa[next[key]++] = i;
+      rank[i] = bucket_end[key];
+    }
+  });
+  std::vector<std::size_t>().swap(counts);
+
+  // head[j] = 1 ssi la ligne j commence un sous-groupe après le tri du tour
+  std::vector<unsigned char> head(n, 0);
+  for (std::size_t h = k; !groups.empty(); h *= 2) {
+    // Un groupe est trié par paires (rang du suffixe h lettres plus loin, suffixe), plus
+    // rapides à comparer que des rangs lus à chaque comparaison. Un suffixe qui commence à
+    // moins de h lettres de la fin peut partager ses h premières lettres, 0 final compris,
+    // avec un suffixe où ce 0 est un séparateur : il est le plus petit du groupe (clé 0,
+    // les autres ayant leur rang + 1).
+    typedef std::pair<sa_type, sa_type> keyed_suffix;
+    auto less = [](const keyed_suffix &a, const keyed_suffix &b) {
+      return a.first < b.first;
+    };
+    auto fill_keys = [&](keyed_suffix *keys, std::size_t begin, std::size_t end) {
+      for (std::size_t j = begin; j < end; ++j) {
+        std::size_t next = (std::size_t) sa[j] + h;
+        keys[j - begin] = keyed_suffix(next < n ? rank[next] + 1 : 0, sa[j]);
+      }
+    };
+    // recopie les suffixes triés de keys dans sa[begin .. end - 1] et marque les débuts des sous-groupes
+    auto store_keys = [&](const keyed_suffix *keys, std::size_t begin, std::size_t end) {
+      for (std::size_t j = begin; j < end; ++j) {
+        sa[j] = keys[j - begin].second;
+        head[j] = j == begin || keys[j - begin - 1].first != keys[j - begin].first;
+      }
+    };
+
+    // lots de groupes consécutifs d'au moins grain suffixes ; les groupes plus grands
+    // qu'une part de thread sont triés à part avec tous les threads
+    std::size_t num_rows = 0;
+    for (const auto &g : groups) {
+      num_rows += g.second - g.first;
+    }
+    const std::size_t big = std::max<std::size_t>(num_rows / num_threads, 1 << 16);
+    std::vector<std::size_t> batches(1, 0); // débuts des lots dans groups
+    for (std::size_t g = 0, size = 0; g < groups.size(); ++g) {
+      size += groups[g].second - groups[g].first;
+      if (size >= grain || g + 1 == groups.size()) {
+        batches.push_back(g + 1);
+        size = 0;
+      }
+    }
+
+    for (const auto &g : groups) {
+      std::size_t size = g.second - g.first;
+      if (size > big) {
+        std::vector<keyed_suffix> keys(size);
+        parallel_chunks(size, 1, num_threads, [&](unsigned int, std::size_t begin, std::size_t end) {
+          fill_keys(keys.data() + begin, g.first + begin, g.first + end);
+        });
+        parallel_sort(keys.begin(), keys.end(), less, num_threads);
+        parallel_chunks(size, 1, num_threads, [&](unsigned int, std::size_t begin, std::size_t end) {
+          for (std::size_t j = begin; j < end; ++j) {
+            sa[g.first + j] = keys[j].second;
+            head[g.first + j] = j == 0 || keys[j - 1].first != keys[j].first;
+          }
+        });
+      }
+    }
+    parallel_tasks(batches.size() - 1, num_threads, [&](std::size_t m) {
+      std::vector<keyed_suffix> keys;
+      for (std::size_t g = batches[m]; g < batches[m + 1]; ++g) {
+        std::size_t start = groups[g].first;
+        std::size_t end = groups[g].second;
+        if (end - start <= big) {
+          keys.resize(end - start);
+          fill_keys(keys.data(), start, end);
+          std::sort(keys.begin(), keys.end(), less);
+          store_keys(keys.data(), start, end);
+        }
+      }
+    });
+
+    // nouveaux rangs et groupes du tour suivant
+    std::vector<std::vector<std::pair<std::size_t, std::size_t> > > next_groups(batches.size() - 1);
+    parallel_tasks(batches.size() - 1, num_threads, [&](std::size_t m) {
+      for (std::size_t g = batches[m]; g < batches[m + 1]; ++g) {
+        std::size_t end = groups[g].second;
+        for (std::size_t a = groups[g].first; a < end;) {
+          std::size_t b = a + 1;
+          while (b < end && !head[b]) {
+            ++b;
+          }
+          for (std::size_t j = a; j < b; ++j) {
+            rank[sa[j]] = b - 1;
+          }
+          head[a] = 0;
+          if (b - a > 1) {
+            next_groups[m].push_back(std::make_pair(a, b));
+          }
+          a = b;
+        }
+      }
+    });
+    groups.clear();
+    for (const auto &v : next_groups) {
+      groups.insert(groups.end(), v.begin(), v.end());
+    }
+  }
+}
+
+}
+
+#endif /* INDEX_PARALLEL_SUFFIX_SORT_H_ */
@@ -0,0 +1,172 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#include "index/rank_kernels.h"
+#include "index/dna_occ.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define DSBWT_X86_KERNELS
+#include <immintrin.h>
+#endif
+
+namespace idx {
+
+namespace {
+
+const std::size_t block_size = 128;
+const std::uint64_t low_bits = 0x5555555555555555ULL;
+
+bool always_supported() {
+  return true;
+}
+
+void generic_rank_batch(const dna_block *blocks, int code, const std::size_t *positions, std::size_t count,
+    std::size_t *ranks) {
+  for (std::size_t k = 0; k < count; ++k) {
+    const dna_block &b = blocks[positions[k] / block_size];
+    ranks[k] = dna_occ::count_before_block(b, positions[k] / block_size, code)
+        + dna_occ::count_in_block(b, code, positions[k] % block_size);
+  }
+}
+
+#ifdef DSBWT_X86_KERNELS
+
+bool popcnt_supported() {
+  return __builtin_cpu_supports("popcnt");
+}
+
+__attribute__((target("popcnt")))
+void popcnt_rank_batch(const dna_block *blocks, int code, const std::size_t *positions, std::size_t count,
+    std::size_t *ranks) {
+  for (std::size_t k = 0; k < count; ++k) {
+    const dna_block &b = blocks[positions[k] / block_size];
+    ranks[k] = dna_occ::count_before_block(b, positions[k] / block_size, code)
+        + dna_occ::count_in_block(b, code, positions[k] % block_size);
+  }
+}
+
+/**
+ * Les 4 mots du bloc sont traités dans un registre de 256 bits :
+ * le mot w est masqué sur ses 2 * (len - 32 * w) bits de poids faible (tous si len - 32 * w >= 32,
+ * aucun si len <= 32 * w), puis les bits sont comptés avec une table de 16 entrées
+ * (vpshufb) et sommés par octets (vpsadbw).
+ */
+bool avx2_supported() {
+  return __builtin_cpu_supports("avx2");
+}
+
+__attribute__((target("avx2")))
+void avx2_rank_batch(const dna_block *blocks, int code, const std::size_t *positions, std::size_t count,
+    std::size_t *ranks) {
+  const __m256i pattern = _mm256_set1_epi64x(low_bits * code);
+  const __m256i low = _mm256_set1_epi64x(low_bits);
+  const __m256i ones = _mm256_set1_epi64x(-1);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i word_offsets = _mm256_setr_epi64x(0, 64, 128, 192);
+  const __m256i nibbles = _mm256_set1_epi8(0x0f);
+  const __m256i popcount_table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+      0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+  for (std::size_t k = 0; k < count; ++k) {
+    const dna_block &b = blocks[positions[k] / block_size];
+    std::size_t len = positions[k] % block_size;
+
+    __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b.bits)), pattern);
+    __m256i matches = _mm256_andnot_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 1)), low);
+    // shift = 2 * len - 64 * w : négatif pour les mots après len, >= 64 pour les mots complets
+    __m256i shift = _mm256_sub_epi64(_mm256_set1_epi64x(2 * len), word_offsets);
+    __m256i mask = _mm256_andnot_si256(_mm256_cmpgt_epi64(zero, shift),
+        _mm256_xor_si256(_mm256_sllv_epi64(ones, shift), ones));
+    matches = _mm256_and_si256(matches, mask);
+
+    __m256i bits_lo = _mm256_shuffle_epi8(popcount_table, _mm256_and_si256(matches, nibbles));
+    __m256i bits_hi = _mm256_shuffle_epi8(popcount_table, _mm256_and_si256(_mm256_srli_epi16(matches, 4), nibbles));
+    __m256i sums = _mm256_sad_epu8(_mm256_add_epi8(bits_lo, bits_hi), zero);
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    s = _mm_add_epi64(s, _mm_unpackhi_epi64(s, s));
+    ranks[k] = dna_occ::count_before_block(b, positions[k] / block_size, code) + (std::size_t) _mm_cvtsi128_si64(s);
+  }
+}
+
+/**
+ * Comme avx2_rank_batch, le masque étant borné par vpminsq/vpmaxsq
+ * et les bits comptés directement par vpopcntq
+ */
+bool avx512_supported() {
+  return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512vl")
+      && __builtin_cpu_supports("avx512vpopcntdq");
+}
+
+__attribute__((target("avx2,avx512f,avx512vl,avx512vpopcntdq")))
+void avx512_rank_batch(const dna_block *blocks, int code, const std::size_t *positions, std::size_t count,
+    std::size_t *ranks) {
+  const __m256i pattern = _mm256_set1_epi64x(low_bits * code);
+  const __m256i low = _mm256_set1_epi64x(low_bits);
+  const __m256i ones = _mm256_set1_epi64x(-1);
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i full = _mm256_set1_epi64x(64);
+  const __m256i word_offsets = _mm256_setr_epi64x(0, 64, 128, 192);
+  for (std::size_t k = 0; k < count; ++k) {
+    const dna_block &b = blocks[positions[k] / block_size];
+    std::size_t len = positions[k] % block_size;
+
+    __m256i x = _mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(b.bits)), pattern);
+    __m256i matches = _mm256_andnot_si256(_mm256_or_si256(x, _mm256_srli_epi64(x, 1)), low);
+    __m256i shift = _mm256_sub_epi64(_mm256_set1_epi64x(2 * len), word_offsets);
+    shift = _mm256_min_epi64(_mm256_max_epi64(shift, zero), full);
+    matches = _mm256_andnot_si256(_mm256_sllv_epi64(ones, shift), matches);
+
+    __m256i sums = _mm256_popcnt_epi64(matches);
+    __m128i s = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+    s = _mm_add_epi64(s, _mm_unpackhi_epi64(s, s));
+    ranks[k] = dna_occ::count_before_block(b, positions[k] / block_size, code) + (std::size_t) _mm_cvtsi128_si64(s);
+  }
+}
+
+#endif
+
+std::vector<rank_kernel> make_rank_kernels() {
+  std::vector<rank_kernel> kernels;
+  kernels.push_back(rank_kernel { "generic", always_supported, generic_rank_batch });
+#ifdef DSBWT_X86_KERNELS
+  kernels.push_back(rank_kernel { "popcnt", popcnt_supported, popcnt_rank_batch });
+  kernels.push_back(rank_kernel { "avx2", avx2_supported, avx2_rank_batch });
+  kernels.push_back(rank_kernel { "avx512", avx512_supported, avx512_rank_batch });
+#endif
+  return kernels;
+}
+
+}
+
+const std::vector<rank_kernel> &rank_kernels() {
+  static const std::vector<rank_kernel> kernels = make_rank_kernels();
+  return kernels;
+}
+
+const rank_kernel &best_rank_kernel() {
+  static const rank_kernel &best = [] () -> const rank_kernel & {
+    const std::vector<rank_kernel> &kernels = rank_kernels();
+    std::size_t k = kernels.size() - 1;
+    while (!kernels[k].supported()) {
+      --k;
+    }
+    return kernels[k];
+  }();
+  return best;
+}
+
+}
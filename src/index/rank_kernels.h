@@ -0,0 +1,66 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef INDEX_RANK_KERNELS_H_
+#define INDEX_RANK_KERNELS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace idx {
+
+/**
+ * Bloc de la table des occurrences de idx::dna_occ (une ligne de cache) :
+ * nombre de A, C et G avant le bloc (celui des T s'en déduit, voir dna_occ::count_before_block),
+ * nombre de 0 avant le bloc et dans le bloc, puis les 128 lettres du bloc codées sur 2 bits
+ */
+struct dna_block {
+  std::uint64_t counts[3];
+  std::uint64_t zeros; // (nombre de 0 avant le bloc << 8) | nombre de 0 dans le bloc
+  std::uint64_t bits[4];
+};
+
+/**
+ * Noyau de calcul des rangs sur une table de dna_block.
+ * rank_batch(blocks, code, positions, count, ranks) : ranks[k] reçoit le nombre de lettres
+ * de code code avant la position positions[k], les 0 du bloc de positions[k] étant comptés
+ * comme des A (voir dna_occ::rank_batch pour la correction).
+ * supported() indique si le processeur courant dispose des instructions du noyau.
+ */
+struct rank_kernel {
+  const char *name;
+  bool (*supported)();
+  void (*rank_batch)(const dna_block *blocks, int code, const std::size_t *positions, std::size_t count,
+      std::size_t *ranks);
+};
+
+/**
+ * Noyaux compilés dans ce binaire, du plus portable au plus rapide.
+ * Le premier ("generic") est toujours supporté.
+ */
+const std::vector<rank_kernel> &rank_kernels();
+
+/**
+ * Le plus rapide des noyaux supportés par le processeur, choisi au premier appel
+ */
+const rank_kernel &best_rank_kernel();
+
+}
+
+#endif /* INDEX_RANK_KERNELS_H_ */
@@ -0,0 +1,153 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#include "index/sequence_table.h"
+#include "index/index_format.h"
+
+#include <stdexcept>
+
+namespace idx {
+
+sequence_table::sequence_table() : n(0), sa_sample_rate(0), num_sequences(0), total_samples(0) {
+}
+
+sequence_table::sequence_table(const std::vector<std::size_t> &lengths, const std::vector<std::string> &names,
+    std::size_t sa_sample_rate)
+    : n(1), sa_sample_rate(sa_sample_rate), num_sequences(lengths.size()), total_samples(0), names(names) {
+  if (!names.empty() && names.size() != lengths.size()) {
+    throw std::runtime_error("sequence_table: one name per sequence expected");
+  }
+  std::vector<std::uint64_t> start_positions;
+  std::vector<std::uint64_t> first_numbers;
+  n = 0;
+  for (std::size_t len : lengths) {
+    if (len == 0) {
+      throw std::runtime_error("empty sequence");
+    }
+    start_positions.push_back(n);
+    n += len + 1;
+    if (sa_sample_rate > 0) {
+      first_numbers.push_back(total_samples);
+      total_samples += (len + sa_sample_rate - 1) / sa_sample_rate;
+    }
+  }
+  if (lengths.empty()) {
+    n = 1; // le 0 final seul
+  }
+  starts = sdsl::sd_vector<>(start_positions.begin(), start_positions.end());
+  first_samples = sdsl::sd_vector<>(first_numbers.begin(), first_numbers.end());
+  init_support();
+}
+
+sequence_table::sequence_table(const sequence_table &o)
+    : n(o.n), sa_sample_rate(o.sa_sample_rate), num_sequences(o.num_sequences), total_samples(o.total_samples),
+      names(o.names), starts(o.starts), first_samples(o.first_samples) {
+  init_support();
+}
+
+sequence_table& sequence_table::operator=(const sequence_table &o) {
+  n = o.n;
+  sa_sample_rate = o.sa_sample_rate;
+  num_sequences = o.num_sequences;
+  total_samples = o.total_samples;
+  names = o.names;
+  starts = o.starts;
+  first_samples = o.first_samples;
+  init_support();
+  return *this;
+}
+
+void sequence_table::init_support() {
+  starts_rank = sdsl::sd_vector<>::rank_1_type(&starts);
+  starts_select = sdsl::sd_vector<>::select_1_type(&starts);
+  first_samples_rank = sdsl::sd_vector<>::rank_1_type(&first_samples);
+  first_samples_select = sdsl::sd_vector<>::select_1_type(&first_samples);
+}
+
+std::string sequence_table::name(std::size_t k) const {
+  if (names.empty() || names[k].empty()) {
+    return std::to_string(k + 1);
+  }
+  return names[k];
+}
+
+sdsl::bit_vector sequence_table::sampled_positions() const {
+  sdsl::bit_vector positions(n, 0);
+  if (sa_sample_rate > 0) {
+    for (std::size_t k = 0; k < num_sequences; ++k) {
+      std::size_t begin = start(k);
+      std::size_t end = begin + length(k);
+      for (std::size_t p = begin; p < end; p += sa_sample_rate) {
+        positions[p] = 1;
+      }
+    }
+  }
+  return positions;
+}
+
+/**
+ * Les noms sont rangés bout à bout, terminés chacun par un 0, complétés par des 0 jusqu'à
+ * un multiple de 8 octets
+ */
+void sequence_table::serialize(std::ostream &out) const {
+  write_value<std::uint64_t>(out, n);
+  write_value<std::uint64_t>(out, sa_sample_rate);
+  write_value<std::uint64_t>(out, num_sequences);
+  write_value<std::uint64_t>(out, total_samples);
+  std::string blob;
+  for (const std::string &s : names) {
+    blob += s;
+    blob.push_back('\0');
+  }
+  write_value<std::uint64_t>(out, names.size());
+  write_value<std::uint64_t>(out, blob.size());
+  blob.resize((blob.size() + 7) / 8 * 8, '\0');
+  write_array(out, blob.data(), blob.size());
+  starts.serialize(out);
+  first_samples.serialize(out);
+}
+
+void sequence_table::load(std::istream &in) {
+  n = read_value<std::uint64_t>(in);
+  sa_sample_rate = read_value<std::uint64_t>(in);
+  num_sequences = read_value<std::uint64_t>(in);
+  total_samples = read_value<std::uint64_t>(in);
+  std::size_t num_names = read_value<std::uint64_t>(in);
+  std::size_t blob_size = read_value<std::uint64_t>(in);
+  if (num_names != 0 && num_names != num_sequences) {
+    throw std::runtime_error("invalid index file");
+  }
+  std::string padded((blob_size + 7) / 8 * 8, '\0');
+  read_array(in, &padded[0], padded.size());
+  names.clear();
+  for (std::size_t i = 0, begin = 0; i < blob_size; ++i) {
+    if (padded[i] == '\0') {
+      names.push_back(padded.substr(begin, i - begin));
+      begin = i + 1;
+    }
+  }
+  if (names.size() != num_names) {
+    throw std::runtime_error("invalid index file");
+  }
+  starts.load(in);
+  first_samples.load(in);
+  init_support();
+}
+
+}
@@ -0,0 +1,215 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+
+#ifndef INDEX_SEQUENCE_TABLE_H_
+#define INDEX_SEQUENCE_TABLE_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include <sdsl/sd_vector.hpp>
+#include <sdsl/vectors.hpp>
+
+namespace idx {
+
+/**
+ * Séquences d'un texte formé de plusieurs séquences (les enregistrements d'un fichier FASTA)
+ * séparées par des 0 : S_0 0 S_1 0 ... S_{m-1} 0, le dernier 0 étant le 0 final. Aucune lettre
+ * d'un motif n'étant compatible avec le 0, la recherche arrière ne traverse jamais un séparateur.
+ *
+ * Les débuts des séquences sont rangés par Elias-Fano (sdsl::sd_vector, environ 2 + log(n / m)
+ * bits par séquence) : la séquence d'une position se retrouve par un rang, son début par une
+ * sélection.
+ *
+ * La table fixe aussi l'échantillon de la table des suffixes : dans chaque séquence, les
+ * positions à une distance multiple de sa_sample_rate du début de la séquence sont échantillonnées
+ * et numérotées dans l'ordre du texte. Le début de chaque séquence est ainsi échantillonné, et
+ * locate() n'a jamais à traverser un séparateur (la ligne d'une lettre 0 ne se remonte pas par LF :
+ * l'ordre des suffixes qui commencent par un 0 n'est pas celui des lignes de la lettre 0).
+ * Les numéros des premiers échantillons des séquences sont aussi rangés par Elias-Fano.
+ */
+class sequence_table {
+public:
+  sequence_table();
+
+  /**
+   * lengths[k] : longueur de la séquence k, non nulle ; names : noms des séquences (vide si elles
+   * n'ont pas de nom) ; sa_sample_rate : 0 si l'index n'a pas de table des suffixes
+   */
+  sequence_table(const std::vector<std::size_t> &lengths, const std::vector<std::string> &names,
+      std::size_t sa_sample_rate);
+
+  /**
+   * Séquences du texte text, séparées par des 0
+   */
+  template<typename letter_type>
+  static std::vector<std::size_t> sequence_lengths(const letter_type *text, std::size_t n) {
+    std::vector<std::size_t> lengths;
+    for (std::size_t i = 0, start = 0; i < n; ++i) {
+      if (text[i] == 0) {
+        lengths.push_back(i - start);
+        start = i + 1;
+      }
+    }
+    return lengths;
+  }
+
+  sequence_table(const sequence_table &o);
+  sequence_table& operator=(const sequence_table &o);
+
+  /**
+   * Nombre de séquences
+   */
+  std::size_t size() const {
+    return num_sequences;
+  }
+
+  /**
+   * Nom de la séquence k, ou son numéro (à partir de 1) si elle n'a pas de nom
+   */
+  std::string name(std::size_t k) const;
+
+  bool has_names() const {
+    return !names.empty();
+  }
+
+  /**
+   * Position du début de la séquence k dans le texte
+   */
+  std::size_t start(std::size_t k) const {
+    return num_sequences == 1 ? 0 : starts_select(k + 1);
+  }
+
+  std::size_t length(std::size_t k) const {
+    return (k + 1 < num_sequences ? start(k + 1) : n) - 1 - start(k);
+  }
+
+  /**
+   * Séquence qui contient la position p (pour un séparateur, la séquence qui le précède)
+   */
+  std::size_t sequence_at(std::size_t p) const {
+    return num_sequences == 1 ? 0 : starts_rank(std::min<std::size_t>(p + 1, starts.size())) - 1;
+  }
+
+  /**
+   * Vrai si text[p .. p + len - 1] est à l'intérieur d'une séquence
+   */
+  bool within_sequence(std::size_t p, std::size_t len) const {
+    std::size_t k = sequence_at(p);
+    return p + len <= start(k) + length(k);
+  }
+
+  /**
+   * Vrai si une séquence commence en p
+   */
+  bool is_start(std::size_t p) const {
+    return p == 0 || (num_sequences > 1 && p < starts.size() && starts[p]);
+  }
+
+  /**
+   * Longueur du texte, séparateurs et 0 final compris
+   */
+  std::size_t text_length() const {
+    return n;
+  }
+
+  std::size_t get_sa_sample_rate() const {
+    return sa_sample_rate;
+  }
+
+  /**
+   * Nombre de positions échantillonnées
+   */
+  std::size_t num_samples() const {
+    return total_samples;
+  }
+
+  /**
+   * Position de l'échantillon numéro number
+   */
+  std::size_t sample_position(std::size_t number) const {
+    if (num_sequences == 1) {
+      return number * sa_sample_rate;
+    }
+    std::size_t k = first_samples_rank(std::min<std::size_t>(number + 1, first_samples.size())) - 1;
+    return start(k) + (number - first_samples_select(k + 1)) * sa_sample_rate;
+  }
+
+  /**
+   * Marque les positions échantillonnées du texte (pour la construction de l'index, voir
+   * position_sampler)
+   */
+  sdsl::bit_vector sampled_positions() const;
+
+  void serialize(std::ostream &out) const;
+  void load(std::istream &in);
+
+private:
+  void init_support();
+
+  std::size_t n;
+  std::size_t sa_sample_rate;
+  std::size_t num_sequences;
+  std::size_t total_samples;
+  std::vector<std::string> names;
+  sdsl::sd_vector<> starts; // débuts des séquences
+  sdsl::sd_vector<>::rank_1_type starts_rank;
+  sdsl::sd_vector<>::select_1_type starts_select;
+  sdsl::sd_vector<> first_samples; // numéro du premier échantillon de chaque séquence
+  sdsl::sd_vector<>::rank_1_type first_samples_rank;
+  sdsl::sd_vector<>::select_1_type first_samples_select;
+};
+
+/**
+ * Positions échantillonnées du texte et leurs numéros en temps constant (n bits et leur rang),
+ * pour remplir l'échantillon de la table des suffixes ligne par ligne pendant la construction
+ */
+class position_sampler {
+public:
+  explicit position_sampler(const sequence_table &sequences)
+      : positions(sequences.sampled_positions()), position_rank(&positions) {
+  }
+
+  bool contains(std::size_t p) const {
+    return positions[p];
+  }
+
+  /**
+   * Numéro de l'échantillon de la position p (voir sequence_table::sample_position)
+   */
+  std::size_t number(std::size_t p) const {
+    return position_rank(p);
+  }
+
+private:
+  position_sampler(const position_sampler &);
+  position_sampler& operator=(const position_sampler &);
+
+  sdsl::bit_vector positions;
+  sdsl::rank_support_v<> position_rank;
+};
+
+}
+
+#endif /* INDEX_SEQUENCE_TABLE_H_ */
@@ -66,14 +66,6 @@ namespace ml {
     letters |= letter;
   }
 
-  bool acgt_multi_letter::contains(const char &letter) const {
-    return (letters & letter) != 0;
-  }
-
-  bool acgt_multi_letter::contains_some_letters(const acgt_multi_letter &multi_letter) const {
-    return (letters & multi_letter.letters) != 0;
-  }
-
   bool acgt_multi_letter::is_equal(const acgt_multi_letter& ml) const {
     return letters == ml.letters;
   }
@@ -42,8 +42,15 @@ public:
   acgt_multi_letter& operator=(acgt_multi_letter &&l);
 
 	void add(const char &letter);
-	bool contains(const char &letter) const;
-	bool contains_some_letters(const acgt_multi_letter &multi_letter) const;
+
+	// Définies ici pour pouvoir être inlinées dans la boucle de la recherche arrière
+	bool contains(const char &letter) const {
+		return (letters & letter) != 0;
+	}
+
+	bool contains_some_letters(const acgt_multi_letter &multi_letter) const {
+		return (letters & multi_letter.letters) != 0;
+	}
 
 	bool is_equal(const acgt_multi_letter& ml) const;
 
@@ -0,0 +1,246 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef ADAPTIVE_FRONTIER_H_
+#define ADAPTIVE_FRONTIER_H_
+
+#include "range.h"
+#include "range_vector.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace ranges {
+
+/**
+ * Ensemble de lignes de la BWT représenté, selon sa densité, soit par des intervalles disjoints
+ * triés (basic_range_vector), soit par un vecteur de bits sur toutes les lignes de la BWT.
+ * Le choix de la représentation est fait par l'étape de la recherche arrière
+ * (voir degenerate_backward_step) ; les intervalles s'ajoutent avec push_back comme dans
+ * un basic_range_vector. Dans les deux cas, le parcours énumère les intervalles maximaux
+ * de lignes consécutives, dans l'ordre croissant.
+ */
+template<typename index_type>
+class basic_adaptive_frontier {
+public:
+  typedef basic_range<index_type> range_type;
+  typedef range_type value_type;
+
+  class const_iterator {
+  public:
+    const_iterator(const basic_adaptive_frontier *f, bool at_end) : frontier(f), current(0, 0) {
+      if (frontier->bitmap_mode) {
+        next_row = at_end ? frontier->n : 0;
+        advance();
+      } else {
+        it = at_end ? frontier->ranges.end() : frontier->ranges.begin();
+      }
+    }
+
+    range_type operator*() const {
+      return frontier->bitmap_mode ? current : *it;
+    }
+
+    const_iterator& operator++() {
+      if (frontier->bitmap_mode) {
+        advance();
+      } else {
+        ++it;
+      }
+      return *this;
+    }
+
+    bool operator==(const const_iterator &o) const {
+      return frontier->bitmap_mode ? next_row == o.next_row && current == o.current : it == o.it;
+    }
+
+    bool operator!=(const const_iterator &o) const {
+      return !(*this == o);
+    }
+
+  private:
+    // current reçoit le premier intervalle de lignes à partir de next_row,
+    // next_row passe après lui (frontier->n et current = [0, 0] à la fin)
+    void advance() {
+      std::size_t low = frontier->next_bit(next_row, true);
+      if (low >= frontier->n) {
+        next_row = frontier->n;
+        current = range_type(0, 0);
+        return;
+      }
+      next_row = frontier->next_bit(low, false);
+      current = range_type(low, next_row - 1);
+    }
+
+    const basic_adaptive_frontier *frontier;
+    typename basic_range_vector<index_type>::const_iterator it;
+    std::size_t next_row;
+    range_type current;
+  };
+
+  basic_adaptive_frontier() : bitmap_mode(false), n(0), num_rows(0), num_runs(0) {
+  }
+
+  void push_back(const range_type &r) {
+    assert(!bitmap_mode);
+    ranges.push_back(r);
+  }
+
+  bool empty() const {
+    return bitmap_mode ? num_rows == 0 : ranges.empty();
+  }
+
+  /**
+   * Vide l'ensemble, qui repasse en intervalles ; la mémoire est conservée
+   */
+  void clear() {
+    bitmap_mode = false;
+    ranges.clear();
+  }
+
+  bool is_bitmap() const {
+    return bitmap_mode;
+  }
+
+  /**
+   * Nombre d'intervalles maximaux de lignes consécutives
+   */
+  std::size_t num_intervals() const {
+    return bitmap_mode ? num_runs : ranges.get_num_nodes();
+  }
+
+  const basic_range_vector<index_type> &get_ranges() const {
+    return ranges;
+  }
+
+  basic_range_vector<index_type> &get_ranges() {
+    return ranges;
+  }
+
+  /**
+   * Passe en vecteur de bits de length lignes, toutes absentes ; les mots sont ensuite
+   * remplis par l'appelant (words()), qui termine avec finish_bitmap
+   */
+  void start_bitmap(std::size_t length) {
+    bitmap_mode = true;
+    n = length;
+    bits.assign((n + 63) / 64, 0);
+  }
+
+  std::uint64_t *words() {
+    return bits.data();
+  }
+
+  const std::uint64_t *words() const {
+    return bits.data();
+  }
+
+  std::size_t num_words() const {
+    return bits.size();
+  }
+
+  /**
+   * Compte les lignes et les intervalles du vecteur de bits ; s'il a moins de
+   * min_runs intervalles, l'ensemble repasse en intervalles
+   */
+  void finish_bitmap(std::size_t min_runs) {
+    num_rows = 0;
+    num_runs = 0;
+    std::uint64_t carry = 0; // dernier bit du mot précédent
+    for (std::uint64_t w : bits) {
+      num_rows += __builtin_popcountll(w);
+      num_runs += __builtin_popcountll(w & ~((w << 1) | carry));
+      carry = w >> 63;
+    }
+    if (num_runs < min_runs) {
+      ranges.clear();
+      for (const_iterator i = begin(); i != end(); ++i) {
+        ranges.push_back(*i);
+      }
+      bitmap_mode = false;
+    }
+  }
+
+  /**
+   * Écrit dans words les bits des lignes des intervalles (le vecteur de bits, de n lignes,
+   * doit avoir été mis à 0)
+   */
+  void fill_bitmap(std::uint64_t *words) const {
+    for (const_iterator i = begin(); i != end(); ++i) {
+      range_type r = *i;
+      for (std::size_t row = r.get_low(); row <= (std::size_t) r.get_high();) {
+        std::size_t o = row % 64;
+        std::size_t k = std::min<std::size_t>(64 - o, r.get_high() - row + 1);
+        words[row / 64] |= (k == 64 ? ~(std::uint64_t) 0 : (((std::uint64_t) 1 << k) - 1)) << o;
+        row += k;
+      }
+    }
+  }
+
+  const_iterator begin() const {
+    return const_iterator(this, false);
+  }
+
+  const_iterator end() const {
+    return const_iterator(this, true);
+  }
+
+  void swap(basic_adaptive_frontier &f) {
+    std::swap(bitmap_mode, f.bitmap_mode);
+    ranges.swap(f.ranges);
+    bits.swap(f.bits);
+    std::swap(n, f.n);
+    std::swap(num_rows, f.num_rows);
+    std::swap(num_runs, f.num_runs);
+  }
+
+private:
+  /**
+   * Première ligne i >= from dont le bit vaut value (n s'il n'y en a pas)
+   */
+  std::size_t next_bit(std::size_t from, bool value) const {
+    if (from >= n) {
+      return n;
+    }
+    std::size_t w = from / 64;
+    std::uint64_t word = (value ? bits[w] : ~bits[w]) & (~(std::uint64_t) 0 << (from % 64));
+    while (word == 0) {
+      if (++w == bits.size()) {
+        return n;
+      }
+      word = value ? bits[w] : ~bits[w];
+    }
+    return std::min(n, w * 64 + __builtin_ctzll(word));
+  }
+
+  bool bitmap_mode;
+  basic_range_vector<index_type> ranges; // si !bitmap_mode
+  std::vector<std::uint64_t> bits; // si bitmap_mode : bit i de bits[i / 64] à 1 ssi la ligne i est dans l'ensemble
+  std::size_t n; // nombre de lignes du vecteur de bits
+  std::size_t num_rows;
+  std::size_t num_runs;
+};
+
+typedef basic_adaptive_frontier<std::int32_t> adaptive_frontier;
+typedef basic_adaptive_frontier<std::int64_t> adaptive_frontier64;
+
+}
+
+#endif /* ADAPTIVE_FRONTIER_H_ */
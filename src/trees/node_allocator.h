@@ -0,0 +1,145 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef NODE_ALLOCATOR_H_
+#define NODE_ALLOCATOR_H_
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace ranges {
+
+/**
+ * Politiques d'allocation des nœuds de red_black_tree.
+ * allocate() renvoie de la mémoire non initialisée pour un node_type,
+ * deallocate() rend la mémoire d'un nœud déjà détruit.
+ * Si bulk_release est vrai, release() rend d'un coup la mémoire de tous les nœuds
+ * (sans appeler leurs destructeurs) : l'arbre n'a pas besoin d'être parcouru pour être vidé.
+ */
+
+/**
+ * Un new / delete par nœud
+ */
+template<class node_type>
+class heap_allocator {
+public:
+  static const bool bulk_release = false;
+
+  node_type *allocate() {
+    return static_cast<node_type *>(::operator new(sizeof(node_type)));
+  }
+
+  void deallocate(node_type *node) {
+    ::operator delete(node);
+  }
+
+  void release() {
+  }
+};
+
+/**
+ * Arène propre à un arbre : les nœuds sont pris à la suite dans des blocs de taille
+ * croissante, les nœuds libérés sont chaînés dans une liste pour être réutilisés,
+ * et release() vide l'arène en conservant ses blocs. Un arbre vidé puis rempli à nouveau
+ * (par exemple une des deux frontières de la recherche arrière) n'alloue donc plus.
+ */
+template<class node_type>
+class arena_allocator {
+public:
+  static const bool bulk_release = true;
+
+  arena_allocator() : block(0), used(0), free_list(nullptr) {
+  }
+
+  arena_allocator(arena_allocator &&arena)
+      : blocks(std::move(arena.blocks)), block(arena.block), used(arena.used), free_list(arena.free_list) {
+    arena.blocks.clear();
+    arena.block = arena.used = 0;
+    arena.free_list = nullptr;
+  }
+
+  arena_allocator &operator=(arena_allocator &&arena) {
+    std::swap(blocks, arena.blocks);
+    std::swap(block, arena.block);
+    std::swap(used, arena.used);
+    std::swap(free_list, arena.free_list);
+    return *this;
+  }
+
+  ~arena_allocator() {
+    for (auto &b : blocks) {
+      ::operator delete(b.first);
+    }
+  }
+
+  node_type *allocate() {
+    if (free_list != nullptr) {
+      free_node *node = free_list;
+      free_list = node->next;
+      return reinterpret_cast<node_type *>(node);
+    }
+    while (block < blocks.size() && used == blocks[block].second) {
+      ++block;
+      used = 0;
+    }
+    if (block == blocks.size()) {
+      std::size_t size = blocks.empty() ? first_block_size : 2 * blocks.back().second;
+      blocks.push_back(std::make_pair(static_cast<slot *>(::operator new(size * sizeof(slot))), size));
+      used = 0;
+    }
+    return reinterpret_cast<node_type *>(&blocks[block].first[used++]);
+  }
+
+  void deallocate(node_type *node) {
+    free_node *f = reinterpret_cast<free_node *>(node);
+    f->next = free_list;
+    free_list = f;
+  }
+
+  void release() {
+    block = used = 0;
+    free_list = nullptr;
+  }
+
+private:
+  arena_allocator(const arena_allocator &) = delete;
+  arena_allocator &operator=(const arena_allocator &) = delete;
+
+  struct free_node {
+    free_node *next;
+  };
+
+  union slot {
+    typename std::aligned_storage<sizeof(node_type), alignof(node_type)>::type node;
+    free_node free;
+  };
+
+  static const std::size_t first_block_size = 16;
+
+  std::vector<std::pair<slot *, std::size_t> > blocks; // blocs et leur nombre de nœuds
+  std::size_t block; // bloc courant
+  std::size_t used; // nombre de nœuds pris dans le bloc courant
+  free_node *free_list;
+};
+
+}
+
+#endif /* NODE_ALLOCATOR_H_ */
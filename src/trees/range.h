@@ -21,32 +21,41 @@
 
 #include <string>
 #include <cassert>
+#include <cstdint>
 #include <iostream>
 
 namespace ranges {
 
-class range {
+/**
+ * Intervalle [low, high] de lignes de la BWT.
+ * index_type doit être un type entier signé suffisamment grand pour
+ * représenter la longueur du texte (voir range et range64).
+ */
+template<typename index_type>
+class basic_range {
 public:
-  range(int left, int right) : low(left), high(right) {
+  typedef index_type value_type;
+
+  basic_range(index_type left, index_type right) : low(left), high(right) {
     assert(left <= right);
   }
 
-  ~range() {
+  ~basic_range() {
   }
 
-  int get_low() const {
+  index_type get_low() const {
     return low;
   }
 
-  int get_high() const {
+  index_type get_high() const {
     return high;
   }
 
-  void set_low(int left) {
+  void set_low(index_type left) {
     low = left;
   }
 
-  void set_high(int right) {
+  void set_high(index_type right) {
     high = right;
   }
 
@@ -57,59 +66,67 @@ public:
   /**
    * @return this->right == r.left
    */
-  bool left_adjacent_to(const range& r) const {
+  bool left_adjacent_to(const basic_range& r) const {
     return this->high == r.low;
   }
 
   /**
    * @return this->left == r.right
    */
-  bool right_adjacent_to(const range& r) const {
+  bool right_adjacent_to(const basic_range& r) const {
     return this->low == r.high;
   }
 
-  bool overlaps(const range& r) const {
+  bool overlaps(const basic_range& r) const {
     return this->low <= r.high && r.low <= this->high;
   }
 
-  bool is_to_the_left_of(const range& r) const {
+  bool is_to_the_left_of(const basic_range& r) const {
     return this->high < r.low;
   }
 
-  bool is_to_the_right_of(const range& r) const {
+  bool is_to_the_right_of(const basic_range& r) const {
     return r.is_to_the_left_of(*this);
   }
 
-  bool operator==(const range& r) const {
+  bool operator==(const basic_range& r) const {
     return this->high == r.high && this->low == r.low;
   }
 
-  bool operator!=(const range& r) const {
+  bool operator!=(const basic_range& r) const {
     return !(*this == r);
   }
 
-  bool operator<(const range& r) const {
+  bool operator<(const basic_range& r) const {
     return this->low < r.low || (this->low == r.low && this->high < r.high);
   }
 
-  bool operator>(const range& r) const {
+  bool operator>(const basic_range& r) const {
     return r < *this;
   }
 
-  bool operator<=(const range& r) const {
+  bool operator<=(const basic_range& r) const {
     return *this < r || *this == r;
   }
-  bool operator>=(const range& r) const {
+  bool operator>=(const basic_range& r) const {
     return *this > r || *this == r;
   }
 
 private:
-  int low;
-  int high;
+  index_type low;
+  index_type high;
 };
 
+typedef basic_range<std::int32_t> range;
+typedef basic_range<std::int64_t> range64;
+
 }
 
-std::ostream& operator<<(std::ostream& stream, const ranges::range& r);
+template<typename index_type>
+std::ostream& operator<<(std::ostream& stream, const ranges::basic_range<index_type>& r) {
+  stream << "[" << r.get_low() << ", " << r.get_high() << "]";
+
+  return stream;
+}
 
 #endif /* RANGE_H_ */
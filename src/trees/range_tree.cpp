@@ -20,28 +20,33 @@
 
 namespace ranges {
 
-range_tree::range_tree() : red_black_tree() {
+template<typename index_type, template<class> class allocator_type>
+basic_range_tree<index_type, allocator_type>::basic_range_tree() : red_black_tree<range_type, allocator_type>() {
   //std::cerr << "range_tree::range_tree()" << std::endl;
 }
 
-range_tree::range_tree(range_tree &&tree) : red_black_tree(std::move(tree)) {
+template<typename index_type, template<class> class allocator_type>
+basic_range_tree<index_type, allocator_type>::basic_range_tree(basic_range_tree &&tree) : red_black_tree<range_type, allocator_type>(std::move(tree)) {
 //  std::cerr << "range_tree::range_tree(range_tree &&tree)" << std::endl;
 }
 
-range_tree& range_tree::operator=(range_tree &&tree) {
+template<typename index_type, template<class> class allocator_type>
+basic_range_tree<index_type, allocator_type>& basic_range_tree<index_type, allocator_type>::operator=(basic_range_tree &&tree) {
   //std::cerr << "range_tree::operator=(range_tree &&tree)" << std::endl;
-  red_black_tree::operator=(std::move(tree));
+  red_black_tree<range_type, allocator_type>::operator=(std::move(tree));
   return *this;
 
 }
 
-void range_tree::tree_insert_node(red_black_tree_node *node) {
+template<typename index_type, template<class> class allocator_type>
+void basic_range_tree<index_type, allocator_type>::tree_insert_node(red_black_tree_node *node) {
   red_black_tree_node *x;
   red_black_tree_node *y;
-  range r = node->get_entry();
+  red_black_tree_node *nil = this->nil;
+  range_type r = node->get_entry();
 
-  y = root;
-  x = root->get_left();
+  y = this->root;
+  x = this->root->get_left();
   while (x != nil && x->get_entry().get_low() - 1 != r.get_high() && x->get_entry().get_high() != r.get_low() - 1) {
     y = x;
     if (r < x->get_entry()) {
@@ -54,7 +59,7 @@ void range_tree::tree_insert_node(red_black_tree_node *node) {
   if (x == nil) {
     // Ajout d'un noeud
     node->set_parent(y);
-    if ((y == root) || (node->get_entry() < y->get_entry())) {
+    if ((y == this->root) || (node->get_entry() < y->get_entry())) {
       y->set_left(node);
     } else {
       y->set_right(node);
@@ -66,34 +71,39 @@ void range_tree::tree_insert_node(red_black_tree_node *node) {
 
     assert(!nil->is_red());
 
-    tree_insert_fixup(node);
-    ++num_nodes;
+    this->tree_insert_fixup(node);
+    ++this->num_nodes;
   } else {
     // Fusion de noeud : le nombre de noeud ne change pas sauf
     // si on fusionne trois noeuds
     if (x->get_entry().get_low() - 1 == r.get_high()) {
       r.set_high(x->get_entry().get_high());
       x->set_entry(r);
-      y = get_maximum_of(x->get_left());
+      y = this->get_maximum_of(x->get_left());
       if (y->get_entry().get_high() == r.get_low() - 1) {
         // l'intervalle touche deux intervalles (un de chaque coté)
         r.set_low(y->get_entry().get_low());
-        delete_node(y);
+        this->delete_node(y);
         x->set_entry(r);
       }
     } else {
       r.set_low(x->get_entry().get_low());
       x->set_entry(r);
-      y = get_minimum_of(x->get_right());
+      y = this->get_minimum_of(x->get_right());
       if (y->get_entry().get_low() - 1 == r.get_high()) {
         // l'intervalle touche deux intervalles (un de chaque coté)
         r.set_high(y->get_entry().get_high());
-        delete_node(y);
+        this->delete_node(y);
         x->set_entry(r);
       }
     }
-    delete node;
+    this->destroy_node(node);
   }
 }
 
+template class basic_range_tree<std::int32_t, arena_allocator>;
+template class basic_range_tree<std::int64_t, arena_allocator>;
+template class basic_range_tree<std::int32_t, heap_allocator>;
+template class basic_range_tree<std::int64_t, heap_allocator>;
+
 }
@@ -24,20 +24,39 @@
 
 namespace ranges {
 
-class range_tree : public red_black_tree<range> {
+/**
+ * Ensemble d'intervalles disjoints : les intervalles adjacents sont fusionnés à l'insertion.
+ * Par défaut les nœuds sont pris dans une arène propre à l'arbre (voir arena_allocator).
+ * Instancié dans range_tree.cpp pour std::int32_t et std::int64_t, avec chacune des deux politiques d'allocation.
+ */
+template<typename index_type, template<class> class allocator_type = arena_allocator>
+class basic_range_tree : public red_black_tree<basic_range<index_type>, allocator_type> {
 public:
-  range_tree();
-  range_tree(range_tree &&tree);
-  range_tree& operator=(range_tree &&tree);
+  typedef basic_range<index_type> range_type;
+  typedef range_type value_type;
+
+  basic_range_tree();
+  basic_range_tree(basic_range_tree &&tree);
+  basic_range_tree& operator=(basic_range_tree &&tree);
 
-  virtual ~range_tree() {
+  virtual ~basic_range_tree() {
     //std::cerr << "~range_tree()" << std::endl;
   };
 
 protected:
+  typedef typename red_black_tree<range_type, allocator_type>::red_black_tree_node red_black_tree_node;
+
   virtual void tree_insert_node(red_black_tree_node *node);
 };
 
+typedef basic_range_tree<std::int32_t> range_tree;
+typedef basic_range_tree<std::int64_t> range_tree64;
+
+extern template class basic_range_tree<std::int32_t, arena_allocator>;
+extern template class basic_range_tree<std::int64_t, arena_allocator>;
+extern template class basic_range_tree<std::int32_t, heap_allocator>;
+extern template class basic_range_tree<std::int64_t, heap_allocator>;
+
 }
 
 #endif /* RANGE_TREE_H_ */
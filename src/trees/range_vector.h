@@ -0,0 +1,93 @@
+/**
+ * dsbwt: Efficient pattern matching in degenerate strings with the
+ * Burrows–Wheeler transform
+ * Copyright (C) 2018 Jacqueline W. Daykin, Richard Groult, Yannick Guesnet,
+ * Thierry Lecroq, Arnaud Lefebvre, Martine Leonard, Laurent Mouchard,
+ * Elise Prieur-Gaston, Bruce Watson
+ * This program is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ * You should have received a copy of the GNU General Public License
+ * along with this program.  If not, see <http://www.gnu.org/licenses/>.
+ **/
+
+#ifndef RANGE_VECTOR_H_
+#define RANGE_VECTOR_H_
+
+#include "range.h"
+
+#include <vector>
+
+namespace ranges {
+
+/**
+ * Ensemble d'intervalles disjoints stockés triés dans un tableau contigu.
+ * Les intervalles doivent être ajoutés dans l'ordre croissant ; un intervalle
+ * adjacent au dernier est fusionné avec lui.
+ * clear() conserve la mémoire allouée : deux basic_range_vector utilisés
+ * alternativement d'une étape à l'autre n'allouent plus après les premières étapes.
+ */
+template<typename index_type>
+class basic_range_vector {
+public:
+  typedef basic_range<index_type> range_type;
+  typedef range_type value_type;
+  typedef typename std::vector<range_type>::const_iterator const_iterator;
+
+  void push_back(const range_type &r) {
+    if (!ranges.empty() && ranges.back().get_high() + 1 == r.get_low()) {
+      ranges.back().set_high(r.get_high());
+    } else {
+      assert(ranges.empty() || ranges.back().is_to_the_left_of(r));
+      ranges.push_back(r);
+    }
+  }
+
+  /**
+   * Ajoute les intervalles de v, qui doivent tous être à droite de ceux de *this
+   */
+  void append(const basic_range_vector &v) {
+    for (const range_type &r : v.ranges) {
+      push_back(r);
+    }
+  }
+
+  bool empty() const {
+    return ranges.empty();
+  }
+
+  void clear() {
+    ranges.clear();
+  }
+
+  std::size_t get_num_nodes() const {
+    return ranges.size();
+  }
+
+  const_iterator begin() const {
+    return ranges.begin();
+  }
+
+  const_iterator end() const {
+    return ranges.end();
+  }
+
+  void swap(basic_range_vector &v) {
+    ranges.swap(v.ranges);
+  }
+
+private:
+  std::vector<range_type> ranges;
+};
+
+typedef basic_range_vector<std::int32_t> range_vector;
+typedef basic_range_vector<std::int64_t> range_vector64;
+
+}
+
+#endif /* RANGE_VECTOR_H_ */
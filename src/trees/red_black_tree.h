@@ -6,6 +6,8 @@
 #include <iostream>
 #include <memory>
 
+#include "node_allocator.h"
+
 /**
  * Freely adapted from Emin Martinian
  * http://web.mit.edu/~emin/www.old/source_code/cpp_trees/
@@ -14,7 +16,10 @@
 namespace ranges {
 
 
-template<class T>
+/**
+ * allocator_type : politique d'allocation des nœuds (voir node_allocator.h)
+ */
+template<class T, template<class> class allocator_type = heap_allocator>
 class red_black_tree {
 protected:
   class red_black_tree_node;
@@ -126,6 +131,10 @@ protected:
   red_black_tree_node * nil;
   red_black_tree_node * root;
   std::size_t num_nodes;
+  allocator_type<red_black_tree_node> allocator;
+
+  red_black_tree_node *create_node(const T &entry);
+  void destroy_node(red_black_tree_node *node);
 
   void delete_node(red_black_tree_node *node);
 
@@ -1,5 +1,6 @@
 #include <cstdio>
 #include <stack>
+#include <type_traits>
 #include <cassert>
 #include <iostream>
 
@@ -24,87 +25,87 @@ namespace ranges {
 #define check_assumptions() ((void) 0)
 #endif
 
-template<class T>
-red_black_tree<T>::red_black_tree_node::red_black_tree_node()
+template<class T, template<class> class allocator_type>
+red_black_tree<T, allocator_type>::red_black_tree_node::red_black_tree_node()
     : red(false), left(this), right(this), parent(this) {
 }
 
-template<class T>
-red_black_tree<T>::red_black_tree_node::red_black_tree_node(const T &entry)
+template<class T, template<class> class allocator_type>
+red_black_tree<T, allocator_type>::red_black_tree_node::red_black_tree_node(const T &entry)
   : entry(entry), red(false), left(nullptr), right(nullptr), parent(nullptr) {
 }
 
-template<class T>
-red_black_tree<T>::red_black_tree_node::~red_black_tree_node() {
+template<class T, template<class> class allocator_type>
+red_black_tree<T, allocator_type>::red_black_tree_node::~red_black_tree_node() {
 }
 
-template<class T>
-const T &red_black_tree<T>::red_black_tree_node::get_entry() const {
+template<class T, template<class> class allocator_type>
+const T &red_black_tree<T, allocator_type>::red_black_tree_node::get_entry() const {
   return entry.e;
 }
 
-template<class T>
-void red_black_tree<T>::red_black_tree_node::set_entry(const T &entry) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::red_black_tree_node::set_entry(const T &entry) {
   this->entry.e = entry;
 }
 
-template<class T>
-void red_black_tree<T>::red_black_tree_node::set_left(red_black_tree_node *node) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::red_black_tree_node::set_left(red_black_tree_node *node) {
   left = node;
 }
 
-template<class T>
-void red_black_tree<T>::red_black_tree_node::set_right(red_black_tree_node *node) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::red_black_tree_node::set_right(red_black_tree_node *node) {
   right = node;
 }
 
-template<class T>
-void red_black_tree<T>::red_black_tree_node::set_parent(red_black_tree_node *node) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::red_black_tree_node::set_parent(red_black_tree_node *node) {
   parent = node;
 }
 
-template<class T>
-const typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::red_black_tree_node::get_left() const {
+template<class T, template<class> class allocator_type>
+const typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::red_black_tree_node::get_left() const {
   return left;
 }
 
-template<class T>
-const typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::red_black_tree_node::get_right() const {
+template<class T, template<class> class allocator_type>
+const typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::red_black_tree_node::get_right() const {
   return right;
 }
 
-template<class T>
-const typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::red_black_tree_node::get_parent() const {
+template<class T, template<class> class allocator_type>
+const typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::red_black_tree_node::get_parent() const {
   return parent;
 }
 
-template<class T>
-typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::red_black_tree_node::get_left() {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::red_black_tree_node::get_left() {
   return left;
 }
 
-template<class T>
-typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::red_black_tree_node::get_right() {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::red_black_tree_node::get_right() {
   return right;
 }
 
-template<class T>
-typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::red_black_tree_node::get_parent() {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::red_black_tree_node::get_parent() {
   return parent;
 }
 
-template<class T>
-bool red_black_tree<T>::red_black_tree_node::is_red() const {
+template<class T, template<class> class allocator_type>
+bool red_black_tree<T, allocator_type>::red_black_tree_node::is_red() const {
   return red;
 }
 
-template<class T>
-void red_black_tree<T>::red_black_tree_node::set_red(bool red) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::red_black_tree_node::set_red(bool red) {
   this->red = red;
 }
 
-template<class T>
-void red_black_tree<T>::red_black_tree_node::print(const red_black_tree_node *nil) const {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::red_black_tree_node::print(const red_black_tree_node *nil) const {
   std::string s;
   s += "[key = ";
   s += std::to_string(this->get_entry());
@@ -121,8 +122,8 @@ void red_black_tree<T>::red_black_tree_node::print(const red_black_tree_node *ni
   std::cout << s << std::endl;
 }
 
-template<class T>
-typename red_black_tree<T>::const_iterator &red_black_tree<T>::const_iterator::operator++() {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::const_iterator &red_black_tree<T, allocator_type>::const_iterator::operator++() {
   if (ptr->right != nil) {
     ptr = ptr->right;
     while (ptr->left != nil) {
@@ -139,26 +140,26 @@ typename red_black_tree<T>::const_iterator &red_black_tree<T>::const_iterator::o
   return *this;
 }
 
-template<class T>
-bool red_black_tree<T>::const_iterator::operator!=(const const_iterator& it) {
+template<class T, template<class> class allocator_type>
+bool red_black_tree<T, allocator_type>::const_iterator::operator!=(const const_iterator& it) {
     return this->ptr != it.ptr;
 }
 
-template<class T>
-const T &red_black_tree<T>::const_iterator::operator*() {
+template<class T, template<class> class allocator_type>
+const T &red_black_tree<T, allocator_type>::const_iterator::operator*() {
   return ptr->get_entry();
 }
 
-template<class T>
-red_black_tree<T>::const_iterator::const_iterator(const red_black_tree_node *node,
+template<class T, template<class> class allocator_type>
+red_black_tree<T, allocator_type>::const_iterator::const_iterator(const red_black_tree_node *node,
         const red_black_tree_node *root, const red_black_tree_node *nil) {
   ptr = node;
   this->nil = nil;
   this->root = root;
 }
 
-template<class T>
-typename red_black_tree<T>::const_iterator red_black_tree<T>::begin() const {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::const_iterator red_black_tree<T, allocator_type>::begin() const {
   const red_black_tree_node *p = root;
   while (p->left != nil) {
     p = p->left;
@@ -166,14 +167,14 @@ typename red_black_tree<T>::const_iterator red_black_tree<T>::begin() const {
   return const_iterator(p, root, nil);
 }
 
-template<class T>
-typename red_black_tree<T>::const_iterator red_black_tree<T>::end() const {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::const_iterator red_black_tree<T, allocator_type>::end() const {
   return const_iterator(root, root, nil);
 }
 
-template<class T>
-red_black_tree<T>::red_black_tree() {
-  //std::cerr << "red_black_tree<T>::red_black_tree()" << std::endl;
+template<class T, template<class> class allocator_type>
+red_black_tree<T, allocator_type>::red_black_tree() {
+  //std::cerr << "red_black_tree<T, allocator_type>::red_black_tree()" << std::endl;
   nil = new red_black_tree_node;
   root = new red_black_tree_node;
   root->parent = root->left = root->right = nil;
@@ -181,9 +182,9 @@ red_black_tree<T>::red_black_tree() {
   num_nodes = 0;
 }
 
-template<class T>
-red_black_tree<T>::red_black_tree(red_black_tree &&tree) {
-  //std::cerr << "red_black_tree<T>::red_black_tree(red_black_tree &&tree)" << std::endl;
+template<class T, template<class> class allocator_type>
+red_black_tree<T, allocator_type>::red_black_tree(red_black_tree &&tree) : allocator(std::move(tree.allocator)) {
+  //std::cerr << "red_black_tree<T, allocator_type>::red_black_tree(red_black_tree &&tree)" << std::endl;
   nil = tree.nil;
   root = tree.root;
   num_nodes = tree.num_nodes;
@@ -192,15 +193,16 @@ red_black_tree<T>::red_black_tree(red_black_tree &&tree) {
   tree.num_nodes = 0;
 }
 
-template<class T>
-red_black_tree<T>& red_black_tree<T>::operator=(red_black_tree<T> &&tree) {
-//  std::cerr << "red_black_tree<T>::operator=(red_black_tree<T> &&tree)" << std::endl;
+template<class T, template<class> class allocator_type>
+red_black_tree<T, allocator_type>& red_black_tree<T, allocator_type>::operator=(red_black_tree<T, allocator_type> &&tree) {
+//  std::cerr << "red_black_tree<T, allocator_type>::operator=(red_black_tree<T, allocator_type> &&tree)" << std::endl;
   clear();
   delete nil;
   delete root;
   nil = tree.nil;
   root = tree.root;
   num_nodes = tree.num_nodes;
+  allocator = std::move(tree.allocator);
   tree.root = nullptr;
   tree.nil = nullptr;
   tree.num_nodes = 0;
@@ -208,18 +210,18 @@ red_black_tree<T>& red_black_tree<T>::operator=(red_black_tree<T> &&tree) {
 }
 
 
-template<class T>
-bool red_black_tree<T>::empty() const {
+template<class T, template<class> class allocator_type>
+bool red_black_tree<T, allocator_type>::empty() const {
   return root->left == nil;
 }
 
-template<class T>
-std::size_t red_black_tree<T>::get_num_nodes() const {
+template<class T, template<class> class allocator_type>
+std::size_t red_black_tree<T, allocator_type>::get_num_nodes() const {
   return num_nodes;
 }
 
-template<class T>
-void red_black_tree<T>::clear() {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::clear() {
   if (root == nullptr) {
     return;
   }
@@ -227,6 +229,12 @@ void red_black_tree<T>::clear() {
   red_black_tree_node *x = root->left;
   std::stack<red_black_tree_node *> stuffToFree;
 
+  if (allocator_type<red_black_tree_node>::bulk_release && std::is_trivially_destructible<T>::value) {
+    // Pas de destructeur à appeler : l'arène rend tous les nœuds d'un coup
+    allocator.release();
+    x = nil;
+  }
+
   if (x != nil) {
     if (x->left != nil) {
       stuffToFree.push(x->left);
@@ -235,7 +243,7 @@ void red_black_tree<T>::clear() {
       stuffToFree.push(x->right);
     }
     // delete x->storedEntry;
-    delete x;
+    destroy_node(x);
     while (!stuffToFree.empty()) {
       x = stuffToFree.top();
       stuffToFree.pop();
@@ -246,7 +254,7 @@ void red_black_tree<T>::clear() {
         stuffToFree.push(x->right);
       }
       // delete x->storedEntry;
-      delete x;
+      destroy_node(x);
     }
   }
 
@@ -254,8 +262,8 @@ void red_black_tree<T>::clear() {
   num_nodes = 0;
 }
 
-template<class T>
-void red_black_tree<T>::left_rotate(red_black_tree_node* x) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::left_rotate(red_black_tree_node* x) {
   red_black_tree_node *y;
  
   y = x->right;
@@ -292,8 +300,8 @@ void red_black_tree<T>::left_rotate(red_black_tree_node* x) {
   assert(!nil->red);
 }
 
-template<class T>
-void red_black_tree<T>::right_rotate(red_black_tree_node* y) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::right_rotate(red_black_tree_node* y) {
   red_black_tree_node* x;
 
   x = y->left;
@@ -329,21 +337,32 @@ void red_black_tree<T>::right_rotate(red_black_tree_node* y) {
   assert(!nil->red);
 }
 
-template<class T>
-void red_black_tree<T>::insert(const T &entry) {
-  red_black_tree_node *z = new red_black_tree_node(entry);
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::insert(const T &entry) {
+  red_black_tree_node *z = create_node(entry);
   tree_insert_node(z);
 }
 
-template<class T>
-void red_black_tree<T>::tree_insert_node(red_black_tree<T>::red_black_tree_node *z) {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::create_node(const T &entry) {
+  return new (allocator.allocate()) red_black_tree_node(entry);
+}
+
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::destroy_node(red_black_tree_node *node) {
+  node->~red_black_tree_node();
+  allocator.deallocate(node);
+}
+
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::tree_insert_node(red_black_tree<T, allocator_type>::red_black_tree_node *z) {
   tree_insert_help(z);
   tree_insert_fixup(z);
   ++num_nodes;
 }
 
-template<class T>
-void red_black_tree<T>::tree_insert_help(red_black_tree<T>::red_black_tree_node *z) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::tree_insert_help(red_black_tree<T, allocator_type>::red_black_tree_node *z) {
   red_black_tree_node *x;
   red_black_tree_node *y;
     
@@ -370,8 +389,8 @@ void red_black_tree<T>::tree_insert_help(red_black_tree<T>::red_black_tree_node
   assert(!nil->red);
 }
 
-template<class T>
-void red_black_tree<T>::tree_insert_fixup(red_black_tree_node *z) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::tree_insert_fixup(red_black_tree_node *z) {
   red_black_tree_node * y;
   while (z->parent->red) { /* use sentinel instead of checking for root */
     if (z->parent == z->parent->parent->left) {
@@ -416,8 +435,8 @@ void red_black_tree<T>::tree_insert_fixup(red_black_tree_node *z) {
   assert(!root->red);
 }
 
-template<class T>
-typename red_black_tree<T>::red_black_tree_node * red_black_tree<T>::get_successor_of(red_black_tree_node * x) const {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::red_black_tree_node * red_black_tree<T, allocator_type>::get_successor_of(red_black_tree_node * x) const {
   red_black_tree_node *y = x->right;
 
   if (y != nil) {
@@ -438,8 +457,8 @@ typename red_black_tree<T>::red_black_tree_node * red_black_tree<T>::get_success
   }
 }
 
-template<class T>
-typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::get_predecessor_of(red_black_tree_node *x) const {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::get_predecessor_of(red_black_tree_node *x) const {
   red_black_tree_node *y = x->left;
 
   if (y != nil) {
@@ -460,8 +479,8 @@ typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::get_predeces
   }
 }
 
-template<class T>
-typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::get_minimum_of(red_black_tree_node *node) {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::get_minimum_of(red_black_tree_node *node) {
   if (node == nil) {
     return nil;
   }
@@ -473,8 +492,8 @@ typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::get_minimum_
   return x;
 }
 
-template<class T>
-typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::get_maximum_of(red_black_tree_node *node) {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::get_maximum_of(red_black_tree_node *node) {
   if (node == nil) {
     return nil;
   }
@@ -487,8 +506,8 @@ typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::get_maximum_
 }
 
 
-template<class T>
-typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::search(const T &entry) {
+template<class T, template<class> class allocator_type>
+typename red_black_tree<T, allocator_type>::red_black_tree_node *red_black_tree<T, allocator_type>::search(const T &entry) {
   red_black_tree_node *x = root->left;
 
   x = root->left;
@@ -505,8 +524,8 @@ typename red_black_tree<T>::red_black_tree_node *red_black_tree<T>::search(const
   return x;
 }
 
-template<class T>
-void red_black_tree<T>::delete_fix_up(red_black_tree_node *x) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::delete_fix_up(red_black_tree_node *x) {
   red_black_tree_node *w;
   red_black_tree_node *rootLeft = root->left;
 
@@ -567,8 +586,8 @@ void red_black_tree<T>::delete_fix_up(red_black_tree_node *x) {
   assert(!nil->red);
 }
 
-template<class T>
-bool red_black_tree<T>::delete_entry(const T& entry) {
+template<class T, template<class> class allocator_type>
+bool red_black_tree<T, allocator_type>::delete_entry(const T& entry) {
   red_black_tree_node *z = search(entry);
   if (z == nil) {
     return false;
@@ -578,8 +597,8 @@ bool red_black_tree<T>::delete_entry(const T& entry) {
   return true;
 }
 
-template<class T>
-void red_black_tree<T>::delete_node(red_black_tree_node *z) {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::delete_node(red_black_tree_node *z) {
   red_black_tree_node *y;
   red_black_tree_node *x;
 
@@ -628,15 +647,15 @@ void red_black_tree<T>::delete_node(red_black_tree_node *z) {
     }
   }
 
-  delete z;
+  destroy_node(z);
   --num_nodes;
 
   check_assumptions();
   assert(!nil->red);
 }
 
-template<class T>
-void red_black_tree<T>::tree_print_helper(red_black_tree_node* x) const {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::tree_print_helper(red_black_tree_node* x) const {
   if (x != nil) {
     tree_print_helper(x->left);
     x->print(nil);
@@ -644,21 +663,21 @@ void red_black_tree<T>::tree_print_helper(red_black_tree_node* x) const {
   }
 }
 
-template<class T>
-red_black_tree<T>::~red_black_tree() {
+template<class T, template<class> class allocator_type>
+red_black_tree<T, allocator_type>::~red_black_tree() {
 //  std::cerr << "~red_black_tree()" << std::endl;
   clear();
   delete nil;
   delete root;
 }
 
-template<class T>
-void red_black_tree<T>::print() const {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::print() const {
   tree_print_helper(root->left);
 }
 
-template<class T>
-void red_black_tree<T>::ca() const {
+template<class T, template<class> class allocator_type>
+void red_black_tree<T, allocator_type>::ca() const {
  	assert(nil->red == 0);
  	assert(root->red == 0);
 }